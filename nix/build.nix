@@ -14,22 +14,31 @@ let
   lib = pkgs.lib;
 
   testNames = [
+    "cache-coherence-benchmark"
     "cpuid"
     "emulator-syscall"
     "exceptions"
     "fpu"
     "hello-world"
+    "ipi-benchmark"
     "lapic-modes"
     "lapic-priority"
     "lapic-timer"
+    "lock-benchmark"
+    "mpmc-queue-benchmark"
     "msr"
     "pagefaults"
+    "pause-loop"
     "pit-timer"
     "sgx"
     "sgx-launch-control"
+    "smp"
     "timing"
     "tsc"
+    "tsc-benchmark"
+    "tsc-sync"
     "tinivisor"
+    "tlb-shootdown-benchmark"
     "vmx"
   ];
 
@@ -55,6 +64,7 @@ let
     let
       dict = {
         hello-world = "--disable-testcases=test_case_is_skipped_by_cmdline";
+        smp = "--parallel-tests";
       };
     in
     dict.${testName} or "";
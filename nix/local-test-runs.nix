@@ -1,9 +1,20 @@
 { pkgs, tests }:
 
 let
+  lib = pkgs.lib;
 
   testNames = builtins.attrNames tests;
 
+  # File that receives the output of the virtio console.
+  virtioConsoleLog = "virtio-console.log";
+
+  # Fails unless the test printed its whole output to the virtio console.
+  checkVirtioConsoleLog = ''
+    echo "Output of the virtio console:"
+    cat ${virtioConsoleLog}
+    grep -q "SOTEST END" ${virtioConsoleLog}
+  '';
+
   # Creates a QEMU command.
   createQemuCommand =
     {
@@ -11,44 +22,59 @@ let
       bootMultiboot ? false,
       bootIso ? false,
       bootEfi ? false,
+      virtioConsole ? false,
       cmdline,
     }:
     let
       qemu = "${pkgs.qemu}/bin/qemu-system-x86_64";
-      base = "${qemu} --machine q35,accel=kvm -no-reboot -display none -cpu host -serial stdio -nodefaults";
+      # The guest only drives modern virtio devices.
+      virtioConsoleArgs = lib.optionalString virtioConsole " -device virtio-serial-pci,disable-legacy=on -chardev file,id=virtiocon,path=${virtioConsoleLog} -device virtconsole,chardev=virtiocon";
+      base = "${qemu} --machine q35,accel=kvm -no-reboot -display none -cpu host -smp 4 -serial stdio -nodefaults${virtioConsoleArgs}";
     in
-    if bootMultiboot then
-      {
-        setup = "${qemu} --version";
-        main = "${base} -kernel ${tests.${testname}.elf32} -append '${cmdline}'";
-      }
-    else if bootIso then
-      {
-        setup = "${qemu} --version";
-        main = "${base} -cdrom ${tests.${testname}.iso}";
-      }
-    else if bootEfi then
-      {
-        setup = ''
-          mkdir -p uefi/EFI/BOOT
-          install -m 0644 ${tests.${testname}.efi} uefi/EFI/BOOT/BOOTX64.EFI
+    lib.optionalAttrs virtioConsole {
+      check = checkVirtioConsoleLog;
+    }
+    // (
+      if bootMultiboot then
+        {
+          setup = "${qemu} --version";
+          main = "${base} -kernel ${tests.${testname}.elf32} -append '${cmdline}'";
+        }
+      else if bootIso then
+        {
+          setup = "${qemu} --version";
+          main = "${base} -cdrom ${tests.${testname}.iso}";
+        }
+      else if bootEfi then
+        {
+          setup = ''
+            mkdir -p uefi/EFI/BOOT
+            install -m 0644 ${tests.${testname}.efi} uefi/EFI/BOOT/BOOTX64.EFI
 
-          ${qemu} --version
-        '';
-        main = "${base} -bios ${pkgs.OVMF.fd}/FV/OVMF.fd -drive format=raw,file=fat:rw:./uefi";
-      }
-    else
-      abort "You must specify one boot variant!";
+            ${qemu} --version
+          '';
+          main = "${base} -bios ${pkgs.OVMF.fd}/FV/OVMF.fd -drive format=raw,file=fat:rw:./uefi";
+        }
+      else
+        abort "You must specify one boot variant!"
+    );
 
   # Creates a Cloud Hypervisor command.
   createChvCommand =
     {
       testname,
+      virtioConsole ? false,
       cmdline,
     }:
+    let
+      console = if virtioConsole then "file=${virtioConsoleLog}" else "off";
+    in
     {
       setup = "${pkgs.cloud-hypervisor}/bin/cloud-hypervisor --version";
-      main = "${pkgs.cloud-hypervisor}/bin/cloud-hypervisor --memory='size=256M' --serial=tty --console=off --kernel=${tests.${testname}.elf64} --cmdline='${cmdline}'";
+      main = "${pkgs.cloud-hypervisor}/bin/cloud-hypervisor --memory='size=256M' --cpus boot=4 --serial=tty --console=${console} --kernel=${tests.${testname}.elf64} --cmdline='${cmdline}'";
+    }
+    // lib.optionalAttrs virtioConsole {
+      check = checkVirtioConsoleLog;
     };
 
   # Creates a single test run of a test.
@@ -88,6 +114,8 @@ let
         echo "Executing \"${vmmCommand.main}\""
         timeout --preserve-status --signal KILL "$timeout" ${vmmCommand.main}
 
+        ${vmmCommand.check or ""}
+
         touch $out
       '';
 
@@ -106,6 +134,9 @@ let
     ) { } testNames;
 
   getDefaultCmdline = testname: tests."${testname}".elf32.meta.testProperties.defaultCmdline;
+
+  # The virtio console is only exercised with hello-world, whose output is checked afterwards.
+  virtioConsoleCmdline = "${getDefaultCmdline "hello-world"} --virtio-console";
 in
 {
   qemu = {
@@ -152,6 +183,17 @@ in
           cmdline = getDefaultCmdline testname;
         }
       );
+      # Direct kernel boot with all output on a virtio console.
+      virtio-console = {
+        hello-world = createTestRun "hello-world" "qemu-kvm_virtio-console" (
+          createQemuCommand {
+            testname = "hello-world";
+            bootMultiboot = true;
+            virtioConsole = true;
+            cmdline = virtioConsoleCmdline;
+          }
+        );
+      };
     };
   };
   chv = {
@@ -164,6 +206,16 @@ in
           cmdline = getDefaultCmdline testname;
         }
       );
+      # All output on a virtio console.
+      virtio-console = {
+        hello-world = createTestRun "hello-world" "chv-kvm_virtio-console" (
+          createChvCommand {
+            testname = "hello-world";
+            virtioConsole = true;
+            cmdline = virtioConsoleCmdline;
+          }
+        );
+      };
     };
   };
 }
@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+
+# Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+Binary Log Decoder
+
+Turns the binary log records of a guest test (see
+src/lib/toyos/include/toyos/util/binlog.hpp) back into text. Everything else
+in the input is passed through unchanged, so the complete console output can
+be piped through this script:
+
+    binlog-decode.py smp.elf64 < console.log
+    socat - UNIX-CONNECT:serial.sock | binlog-decode.py smp.elf64
+
+The ELF file has to be the one the test was run from, because the records only
+refer to the call site descriptors in its .trace_sites section.
+"""
+
+import re
+import struct
+import sys
+
+RECORD_MARKER = 0x1E
+VERSION = 1
+HEADER_SIZE = 3
+SITE_ID_SIZE = 4
+SITE_SIZE = 40
+
+SHT_NOBITS = 8
+
+# printf conversions as produced by pprintpp.
+CONVERSION = re.compile(
+    rb"%([-#0 +]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsp%])"
+)
+
+LENGTH_BITS = {
+    b"hh": 8,
+    b"h": 16,
+    None: 32,
+    b"l": 64,
+    b"ll": 64,
+    b"z": 64,
+    b"j": 64,
+    b"t": 64,
+}
+
+
+class Elf:
+    """Just enough of an ELF64 parser to read strings and descriptors."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 2:
+            raise ValueError(f"{path} is not an ELF64 file")
+
+        shoff = struct.unpack_from("<Q", self.data, 0x28)[0]
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x3A)
+
+        headers = [
+            struct.unpack_from("<IIQQQQ", self.data, shoff + i * shentsize)
+            for i in range(shnum)
+        ]
+        names_offset = headers[shstrndx][4]
+
+        # name -> (address, file offset, size, type)
+        self.sections = {}
+        for name, sh_type, _, addr, offset, size in headers:
+            end = self.data.index(b"\0", names_offset + name)
+            section_name = self.data[names_offset + name : end].decode()
+            self.sections[section_name] = (addr, offset, size, sh_type)
+
+    def read(self, addr, size):
+        for sec_addr, offset, sec_size, sh_type in self.sections.values():
+            if sh_type != SHT_NOBITS and sec_addr <= addr < sec_addr + sec_size:
+                start = offset + addr - sec_addr
+                return self.data[start : start + size]
+        raise ValueError(f"address {addr:#x} is not part of the ELF file")
+
+    def string(self, addr):
+        for sec_addr, offset, sec_size, sh_type in self.sections.values():
+            if sh_type != SHT_NOBITS and sec_addr <= addr < sec_addr + sec_size:
+                start = offset + addr - sec_addr
+                return self.data[start : self.data.index(b"\0", start)]
+        raise ValueError(f"address {addr:#x} is not part of the ELF file")
+
+
+class Site:
+    def __init__(self, elf, fmt, file, level, types, line):
+        self.format = elf.string(fmt)
+        self.file = elf.string(file)
+        self.level = elf.string(level)
+        self.types = elf.string(types).decode()
+        self.line = line
+
+
+def load_sites(elf):
+    if ".trace_sites" not in elf.sections:
+        return {}
+
+    addr, _, size, _ = elf.sections[".trace_sites"]
+    table = elf.read(addr, size)
+
+    sites = {}
+    for off in range(0, size - size % SITE_SIZE, SITE_SIZE):
+        fields = struct.unpack_from("<5Q", table, off)
+        # The guest only sends the lower 32 bits of the descriptor address.
+        sites[(addr + off) & 0xFFFFFFFF] = Site(elf, *fields)
+    return sites
+
+
+def read_leb128(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError("truncated argument")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def decode_args(types, payload):
+    args = []
+    pos = 0
+    for arg_type in types:
+        value, pos = read_leb128(payload, pos)
+        if arg_type == "i":
+            value = (value >> 1) ^ -(value & 1)
+        elif arg_type == "s":
+            if pos + value > len(payload):
+                raise ValueError("truncated string")
+            value, pos = payload[pos : pos + value], pos + value
+        args.append(value)
+    return args
+
+
+def format_message(fmt, args):
+    """Apply a printf format string to already decoded arguments."""
+    args = iter(args)
+
+    def convert(match):
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == b"%":
+            return b"%"
+
+        value = next(args)
+        spec = b"%" + flags + width + (b"." + precision if precision else b"")
+
+        if isinstance(value, bytes):
+            # char pointers always travel as strings, even when printed with %p.
+            return (spec + b"s") % value
+        if conversion == b"c":
+            return (spec + b"c") % (value & 0xFF)
+        if conversion == b"p":
+            return (spec + b"#x") % value
+        if conversion in b"ouxX" and value < 0:
+            value &= (1 << LENGTH_BITS[length]) - 1
+        if conversion in b"iu":
+            conversion = b"d"
+        return (spec + conversion) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode_record(sites, record):
+    site_id = struct.unpack_from("<I", record, HEADER_SIZE)[0]
+    site = sites.get(site_id)
+    if site is None:
+        return f"[binlog: unknown call site {site_id:#x}]\n".encode()
+
+    args = decode_args(site.types, record[HEADER_SIZE + SITE_ID_SIZE :])
+    message = format_message(site.format, args)
+    return b"[%s %s:%d] %s\n" % (site.level, site.file, site.line, message)
+
+
+def decode_stream(sites, read, write):
+    buffer = b""
+    while True:
+        chunk = read()
+        if not chunk:
+            write(buffer)
+            return
+        buffer += chunk
+
+        while buffer:
+            start = buffer.find(bytes([RECORD_MARKER]))
+            if start < 0:
+                write(buffer)
+                buffer = b""
+                break
+
+            write(buffer[:start])
+            buffer = buffer[start:]
+
+            if len(buffer) < HEADER_SIZE:
+                break
+
+            length = buffer[2]
+            if buffer[1] != VERSION or length < SITE_ID_SIZE:
+                # Not a record after all.
+                write(buffer[:1])
+                buffer = buffer[1:]
+                continue
+
+            if len(buffer) < HEADER_SIZE + length:
+                break
+
+            record = buffer[: HEADER_SIZE + length]
+            buffer = buffer[HEADER_SIZE + length :]
+            try:
+                write(decode_record(sites, record))
+            except (ValueError, StopIteration, TypeError) as e:
+                write(f"[binlog: malformed record: {e}]\n".encode())
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print(f"usage: {sys.argv[0]} <test ELF> [log file]", file=sys.stderr)
+        return 1
+
+    sites = load_sites(Elf(sys.argv[1]))
+
+    log = open(sys.argv[2], "rb") if len(sys.argv) == 3 else sys.stdin.buffer
+
+    def write(data):
+        sys.stdout.buffer.write(data)
+        sys.stdout.buffer.flush()
+
+    with log:
+        decode_stream(sites, lambda: log.read1(4096), write)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
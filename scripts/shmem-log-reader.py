@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+
+# Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+Shared Memory Log Reader
+
+Drains the output queue a guest test writes with --shmem-log (see
+src/lib/toyos/include/toyos/console/console_shmem.hpp) and prints it to
+stdout. The file is whatever backs the shared memory on the host, for example
+the mem-path of the memory backend of an ivshmem device in QEMU:
+
+    -object memory-backend-file,id=log,size=1M,share=on,mem-path=/dev/shm/log
+    -device ivshmem-plain,memdev=log
+
+    shmem-log-reader.py /dev/shm/log
+
+If the queue lives in guest RAM instead, pass the file that backs the guest RAM
+and the address of the queue as offset.
+
+The output can be piped into binlog-decode.py as well. The reader runs until
+it is interrupted.
+"""
+
+import mmap
+import struct
+import sys
+import time
+
+LFQ_API_VERSION = 1
+CHUNK_SIZE = 128
+
+META_OFFSET = 0
+READ_POSITION_OFFSET = 64
+WRITE_POSITION_OFFSET = 128
+ENTRIES_OFFSET = 192
+
+POLL_INTERVAL = 0.01
+
+
+class Queue:
+    """Consumer side of a lock_less_queue_t with shmem::chunk entries."""
+
+    def __init__(self, mem, offset):
+        self.mem = mem
+        self.offset = offset
+
+    def u64(self, offset):
+        return struct.unpack_from("<Q", self.mem, self.offset + offset)[0]
+
+    def ready(self):
+        version, entry_num, entry_size = struct.unpack_from(
+            "<QQQ", self.mem, self.offset + META_OFFSET
+        )
+        return version == LFQ_API_VERSION and entry_size == CHUNK_SIZE and entry_num > 0
+
+    def drain(self, write):
+        """Write out all chunks in the queue. Returns False if it was empty."""
+        slots = self.u64(8) + 1
+        read_position = self.u64(READ_POSITION_OFFSET)
+        write_position = self.u64(WRITE_POSITION_OFFSET)
+        if read_position == write_position:
+            return False
+
+        while read_position != write_position:
+            entry = self.offset + ENTRIES_OFFSET + read_position * CHUNK_SIZE
+            size = struct.unpack_from("<I", self.mem, entry)[0]
+            write(self.mem[entry + 4 : entry + 4 + min(size, CHUNK_SIZE - 4)])
+
+            read_position = (read_position + 1) % slots
+            # Hand the slot back to the guest.
+            struct.pack_into(
+                "<Q", self.mem, self.offset + READ_POSITION_OFFSET, read_position
+            )
+        return True
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print(f"usage: {sys.argv[0]} <shared memory file> [offset]", file=sys.stderr)
+        return 1
+
+    offset = int(sys.argv[2], 0) if len(sys.argv) == 3 else 0
+
+    def write(data):
+        sys.stdout.buffer.write(data)
+        sys.stdout.buffer.flush()
+
+    with open(sys.argv[1], "r+b") as f:
+        mem = mmap.mmap(f.fileno(), 0)
+        queue = Queue(mem, offset)
+
+        try:
+            while not queue.ready():
+                time.sleep(POLL_INTERVAL)
+
+            while True:
+                if not queue.drain(write):
+                    time.sleep(POLL_INTERVAL)
+        except KeyboardInterrupt:
+            pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -215,6 +215,8 @@ unsigned long long strtoull(const char* str, char** str_end, int base)
 
         ++p;
     }
+
+    setend(p);
     return accum;
 }
 
@@ -264,6 +266,8 @@ unsigned long strtoul(const char* str, char** str_end, int base)
 
         ++p;
     }
+
+    setend(p);
     return accum;
 }
 
@@ -26,3 +26,9 @@
 #define STACK_SIZE_VIRT (1 << STACK_BITS_VIRT)
 
 #define HEAP_ALIGNMENT (0x10)
+
+/** Physical address the startup code of application processors is copied to.
+ * It has to be page-aligned and below 1 MiB, because APs start in real mode
+ * at the page given in the STARTUP IPI.
+ */
+#define AP_TRAMPOLINE_ADDR (0x1000)
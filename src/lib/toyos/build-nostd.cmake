@@ -2,15 +2,21 @@
 
 add_library(
   toyos STATIC
+  src/ap_trampoline.S
   src/boot.cpp
   src/console_serial.cpp
   src/console_serial_util.cpp
+  src/console_shmem.cpp
+  src/console_shmem_util.cpp
+  src/console_virtio.cpp
+  src/deferred_log.cpp
   src/init.S
   src/mm.cpp
   src/pd.cpp
   src/pdpt.cpp
   src/pml4.cpp
   src/pt.cpp
+  src/smp.cpp
   src/string_util.cpp
   src/tinivisor.cpp
   src/vmxexit.S
@@ -22,6 +28,7 @@ add_library(
   src/testhelper/entry.S
   src/testhelper/irq_handler.cpp
   src/testhelper/lapic_test_tools.cpp
+  src/testhelper/x2apic_test_tools.cpp
   src/xhci/console_base.cpp
   src/xhci/debug_device.cpp
   src/xhci/debug_device_transfers.cpp
@@ -31,13 +31,12 @@ static acpi_rsdp* find_rsdp(const cbl::interval& ival)
 }
 
 /*
- * Finds the MCFG table from the given RSDP. If RSDP is not provided, the
- * function tries to find the structure.
+ * Returns the given RSDP or, if none is provided, tries to find it in the
+ * legacy BIOS areas.
  *
- * It is valid that this function returns a null pointer, when the MCFG is not
- * found.
+ * Returns a null pointer if no valid RSDP is found.
  */
-static acpi_mcfg* find_mcfg(const acpi_rsdp* rsdp = nullptr)
+static const acpi_rsdp* locate_rsdp(const acpi_rsdp* rsdp)
 {
     // Find RSDP structure in either
     // (1) The first KiB of the EBDA
@@ -65,19 +64,76 @@ static acpi_mcfg* find_mcfg(const acpi_rsdp* rsdp = nullptr)
         return nullptr;
     }
 
+    return rsdp;
+}
+
+/*
+ * Finds the ACPI table with the given signature. The RSDT is preferred, the
+ * XSDT is only used if there is no RSDT.
+ *
+ * Returns a null pointer if the table is not found.
+ */
+static acpi_table_header* find_acpi_table(const acpi_rsdp& rsdp, const char* signature)
+{
+    if (rsdp.rsdt) {
+        acpi_rsdt* rsdt = num_to_ptr<acpi_rsdt>(rsdp.rsdt);
+
+        for (size_t idx{ 0 }; idx < rsdt->number_of_entries(); idx++) {
+            char* table_pointer = num_to_ptr<char>(rsdt->entry(idx));
+            if (not memcmp(table_pointer, signature, 4)) {
+                return reinterpret_cast<acpi_table_header*>(table_pointer);
+            }
+        }
+    }
+    else if (rsdp.revision >= 2 and rsdp.xsdt) {
+        acpi_xsdt* xsdt = num_to_ptr<acpi_xsdt>(rsdp.xsdt);
+
+        for (size_t idx{ 0 }; idx < xsdt->number_of_entries(); idx++) {
+            char* table_pointer = num_to_ptr<char>(xsdt->entry(idx));
+            if (not memcmp(table_pointer, signature, 4)) {
+                return reinterpret_cast<acpi_table_header*>(table_pointer);
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+/*
+ * Finds the MCFG table from the given RSDP. If RSDP is not provided, the
+ * function tries to find the structure.
+ *
+ * It is valid that this function returns a null pointer, when the MCFG is not
+ * found.
+ */
+static acpi_mcfg* find_mcfg(const acpi_rsdp* rsdp = nullptr)
+{
+    rsdp = locate_rsdp(rsdp);
+    if (not rsdp) {
+        return nullptr;
+    }
+
     // Is null when directly booted by Cloud Hypervisor.
     if (!rsdp->rsdt) {
         return nullptr;
     }
 
-    acpi_rsdt* rsdt = num_to_ptr<acpi_rsdt>(rsdp->rsdt);
+    return reinterpret_cast<acpi_mcfg*>(find_acpi_table(*rsdp, "MCFG"));
+}
 
-    for (size_t idx{ 0 }; idx < rsdt->number_of_entries(); idx++) {
-        char* table_pointer = num_to_ptr<char>(rsdt->entry(idx));
-        if (not memcmp(table_pointer, "MCFG", 4)) {
-            return reinterpret_cast<acpi_mcfg*>(table_pointer);
-        }
+/*
+ * Finds the MADT from the given RSDP. If RSDP is not provided, the function
+ * tries to find the structure.
+ *
+ * It is valid that this function returns a null pointer, when the MADT is not
+ * found.
+ */
+static acpi_madt* find_madt(const acpi_rsdp* rsdp = nullptr)
+{
+    rsdp = locate_rsdp(rsdp);
+    if (not rsdp) {
+        return nullptr;
     }
 
-    return nullptr;
+    return reinterpret_cast<acpi_madt*>(find_acpi_table(*rsdp, "APIC"));
 }
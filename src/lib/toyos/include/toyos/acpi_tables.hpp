@@ -59,6 +59,23 @@ struct acpi_rsdt : acpi_table_header
 #pragma pack(pop)
 static_assert(sizeof(acpi_rsdt) == 36, "RSDT size incorrect!");
 
+#pragma pack(push, 1)
+struct acpi_xsdt : acpi_table_header
+{
+    uint64_t desc_base[];
+
+    size_t number_of_entries() const
+    {
+        return (length - sizeof(acpi_xsdt)) / sizeof(uint64_t);
+    }
+    uint64_t entry(size_t idx) const
+    {
+        return desc_base[idx];
+    }
+};
+#pragma pack(pop)
+static_assert(sizeof(acpi_xsdt) == 36, "XSDT size incorrect!");
+
 #pragma pack(push, 1)
 struct acpi_mcfg : acpi_table_header
 {
@@ -222,3 +239,132 @@ struct acpi_drhd : acpi_remap
     // Dynamic device scope entries follow here
 };
 #pragma pack(pop)
+
+#pragma pack(push, 1)
+// Interrupt Controller Structure Header. See ACPI Specification 5.2.12.
+struct acpi_madt_entry
+{
+    enum type_t : uint8_t
+    {
+        LOCAL_APIC = 0,
+        IO_APIC = 1,
+        INTERRUPT_SOURCE_OVERRIDE = 2,
+        LOCAL_X2APIC = 9,
+    };
+
+    type_t type;
+    uint8_t length;
+};
+
+// Processor Local APIC Structure. See ACPI Specification 5.2.12.2.
+struct acpi_madt_local_apic : acpi_madt_entry
+{
+    uint8_t acpi_processor_uid;
+    uint8_t apic_id;
+    uint32_t flags;
+
+    bool enabled() const
+    {
+        return flags & 1;
+    }
+};
+
+// Processor Local x2APIC Structure. See ACPI Specification 5.2.12.12.
+struct acpi_madt_local_x2apic : acpi_madt_entry
+{
+    uint16_t reserved;
+    uint32_t x2apic_id;
+    uint32_t flags;
+    uint32_t acpi_processor_uid;
+
+    bool enabled() const
+    {
+        return flags & 1;
+    }
+};
+#pragma pack(pop)
+static_assert(sizeof(acpi_madt_local_apic) == 8, "MADT Local APIC structure size incorrect!");
+static_assert(sizeof(acpi_madt_local_x2apic) == 16, "MADT Local x2APIC structure size incorrect!");
+
+// Iterator for interrupt controller structures of a MADT.
+class madt_entry_iterator
+{
+ public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = const acpi_madt_entry&;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = const acpi_madt_entry&&;
+
+    explicit madt_entry_iterator(uintptr_t cur_entry_, uintptr_t end_addr_)
+        : cur_entry(cur_entry_), end_addr(end_addr_)
+    {}
+
+    const acpi_madt_entry& operator*() const
+    {
+        return *reinterpret_cast<acpi_madt_entry*>(cur_entry);
+    }
+
+    bool operator!=(const madt_entry_iterator&) const
+    {
+        return cur_entry < end_addr;
+    }
+
+    madt_entry_iterator& operator++()
+    {
+        auto length{ reinterpret_cast<acpi_madt_entry*>(cur_entry)->length };
+
+        // A zero length would make us loop forever.
+        cur_entry = length ? cur_entry + length : end_addr;
+
+        if (cur_entry > end_addr) {
+            cur_entry = end_addr;
+        }
+
+        return *this;
+    }
+
+ private:
+    uintptr_t cur_entry;
+    uintptr_t end_addr;
+};
+
+#pragma pack(push, 1)
+// Multiple APIC Description Table. See ACPI Specification 5.2.12.
+struct acpi_madt : acpi_table_header
+{
+    uint32_t local_apic_address;
+    uint32_t flags;
+
+    /// Helper class to provide an iterator over interrupt controller structures.
+    struct madt_entry_list
+    {
+     public:
+        explicit madt_entry_list(const acpi_madt& madt_)
+            : madt(madt_) {}
+
+        madt_entry_iterator begin() const
+        {
+            auto madt_addr{ reinterpret_cast<uintptr_t>(&madt) };
+            return madt_entry_iterator{ madt_addr + sizeof(acpi_madt), madt_addr + madt.length };
+        }
+
+        madt_entry_iterator end() const
+        {
+            auto madt_addr{ reinterpret_cast<uintptr_t>(&madt) };
+            return madt_entry_iterator{ madt_addr + madt.length, madt_addr + madt.length };
+        }
+
+     private:
+        const acpi_madt& madt;
+    };
+
+    // Returns a iterable range of interrupt controller structures that can
+    // have different types, most notably the local APICs of all processors.
+    madt_entry_list entries() const
+    {
+        return madt_entry_list(*this);
+    }
+};
+#pragma pack(pop)
+static_assert(sizeof(acpi_madt) == 44, "MADT size incorrect!");
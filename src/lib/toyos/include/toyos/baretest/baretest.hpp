@@ -30,8 +30,14 @@ namespace baretest
         const char* name;
         test_case_fn fn_;
 
-        test_case(test_suite& suite, const char* name, test_case_fn tc);
+        /// Serial test cases never run concurrently to other test cases.
+        bool serial;
+
+        test_case(test_suite& suite, const char* name, test_case_fn tc, bool serial = true);
         bool run() const;
+
+        /// Print the SoTest result line for the given result of this test case.
+        bool report(result_t res) const;
     };
 
     class test_suite
@@ -39,11 +45,22 @@ namespace baretest
      private:
         std::vector<test_case> test_cases;
 
+        /**
+         * Distribute test cases among all CPUs. Results are reported in the
+         * order of the test cases.
+         */
+        void run_parallel();
+
      public:
         void add(test_case tc)
         {
             test_cases.push_back(tc);
         }
+
+        /**
+         * Run all test cases. With the parallel-tests cmdline modifier, test
+         * cases declared as parallel run concurrently on all available CPUs.
+         */
         void run();
 
         size_t get_test_count() const
@@ -63,35 +80,49 @@ namespace baretest
 
 }  // namespace baretest
 
-#define TEST_CASE_CONDITIONAL(test_name, condition)                           \
-    static baretest::test_case::result_t test_##test_name();                  \
-    static void test_impl_##test_name();                                      \
-    namespace baretest                                                        \
-    {                                                                         \
-        test_case tc_##test_name(get_suite(), #test_name, &test_##test_name); \
-    }                                                                         \
-    baretest::test_case::result_t test_##test_name()                          \
-    {                                                                         \
-        printf("test case: %s\n", __func__);                                  \
-        if (not(condition)) {                                                 \
-            printf("- skipping as condition is NOT met: `" #condition "`\n"); \
-            return baretest::test_case::result_t::SKIPPED;                    \
-        }                                                                     \
-        if (baretest::testcase_disabled_by_cmdline(#test_name)) {             \
-            printf("- skipping as test case is disabled via cmdline\n");      \
-            return baretest::test_case::result_t::SKIPPED;                    \
-        }                                                                     \
-        int val = setjmp(baretest::get_env());                                \
-        if (val) {                                                            \
-            return baretest::test_case::result_t::FAILURE;                    \
-        }                                                                     \
-        test_impl_##test_name();                                              \
-        return baretest::test_case::result_t::SUCCESS;                        \
-    }                                                                         \
+#define BARETEST_TEST_CASE(test_name, condition, serial)                              \
+    static baretest::test_case::result_t test_##test_name();                          \
+    static void test_impl_##test_name();                                              \
+    namespace baretest                                                                \
+    {                                                                                 \
+        test_case tc_##test_name(get_suite(), #test_name, &test_##test_name, serial); \
+    }                                                                                 \
+    baretest::test_case::result_t test_##test_name()                                  \
+    {                                                                                 \
+        printf("test case: %s\n", __func__);                                          \
+        if (not(condition)) {                                                         \
+            printf("- skipping as condition is NOT met: `" #condition "`\n");         \
+            return baretest::test_case::result_t::SKIPPED;                            \
+        }                                                                             \
+        if (baretest::testcase_disabled_by_cmdline(#test_name)) {                     \
+            printf("- skipping as test case is disabled via cmdline\n");              \
+            return baretest::test_case::result_t::SKIPPED;                            \
+        }                                                                             \
+        int val = setjmp(baretest::get_env());                                        \
+        if (val) {                                                                    \
+            return baretest::test_case::result_t::FAILURE;                            \
+        }                                                                             \
+        test_impl_##test_name();                                                      \
+        return baretest::test_case::result_t::SUCCESS;                                \
+    }                                                                                 \
     void test_impl_##test_name()
 
+/**
+ * Test cases run one after another on the bootstrap processor, even with the
+ * parallel-tests cmdline modifier, because most of them modify global state
+ * such as the PIC, the IOAPIC, the LAPIC or the VMX state of the BSP.
+ */
+#define TEST_CASE_CONDITIONAL(test_name, condition) BARETEST_TEST_CASE(test_name, condition, true)
 #define TEST_CASE(test_name) TEST_CASE_CONDITIONAL(test_name, true)
 
+/**
+ * Test cases that only touch their own data and may run concurrently to other
+ * test cases on any CPU. With the parallel-tests cmdline modifier, they run on
+ * APs with interrupts and the LAPIC disabled.
+ */
+#define TEST_CASE_CONDITIONAL_PARALLEL(test_name, condition) BARETEST_TEST_CASE(test_name, condition, false)
+#define TEST_CASE_PARALLEL(test_name) TEST_CASE_CONDITIONAL_PARALLEL(test_name, true)
+
 /**
  * Print information about environment, such as the command line of the test.
  */
@@ -5,6 +5,13 @@
 #include <optional>
 #include <string_view>
 
+struct acpi_rsdp;
+
+namespace x86
+{
+    struct tss;
+}
+
 enum class boot_method
 {
     MULTIBOOT1,
@@ -19,6 +26,21 @@ std::string_view boot_method_name(boot_method method);
  */
 extern std::optional<boot_method> current_boot_method;
 
+/**
+ * Returns the RSDP provided by the boot loader.
+ *
+ * A null pointer means the boot loader did not provide one and it has to be
+ * searched for in the legacy BIOS areas.
+ */
+const acpi_rsdp* get_boot_rsdp();
+
+/**
+ * \brief Install the given TSS in the TSS descriptor of the current GDT and load it.
+ *
+ * Every CPU needs its own TSS and hence its own GDT, because loading a TSS marks its descriptor busy.
+ */
+void load_tss(x86::tss& cpu_tss);
+
 /**
  * LOAD address specified in linker script.
  */
@@ -32,3 +54,16 @@ static uint32_t load_addr()
     // This is true as long as libtoyos is not relocatable in physical memory.
     return (uint32_t)reinterpret_cast<uint64_t>(&LOAD_ADDR);
 }
+
+/**
+ * End of the image including .bss, specified in linker script.
+ */
+extern uint32_t IMAGE_END;
+
+/**
+ * Returns the runtime end address of the image.
+ */
+static uint32_t image_end()
+{
+    return (uint32_t)reinterpret_cast<uint64_t>(&IMAGE_END);
+}
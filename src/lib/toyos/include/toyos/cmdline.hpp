@@ -23,6 +23,7 @@ namespace cmdline
     namespace optionparser
     {
         constexpr char DISABLED_TESTCASES_DELIMITER = ',';
+        constexpr char TRACE_CATEGORIES_DELIMITER = ',';
 
         /**
          * Index into the `usage` array.
@@ -32,7 +33,15 @@ namespace cmdline
             SERIAL,
             XHCI,
             XHCI_POWER,
+            XHCI_SINGLE_TRANSFER,
             DISABLED_TESTCASES,
+            JITTER_DURATION,
+            PARALLEL_TESTS,
+            DEBUGCON_BYTE_IO,
+            VIRTIO_CONSOLE,
+            BINARY_LOG,
+            TRACE,
+            SHMEM_LOG,
         };
 
         /**
@@ -45,7 +54,15 @@ namespace cmdline
             { SERIAL, 0, "", "serial", option::Arg::Optional, "" },
             { XHCI, 0, "", "xhci", option::Arg::Optional, "" },
             { XHCI_POWER, 0, "", "xhci-power", option::Arg::Optional, "" },
+            { XHCI_SINGLE_TRANSFER, 0, "", "xhci-single-transfer", option::Arg::Optional, "" },
             { DISABLED_TESTCASES, 0, "", "disable-testcases", option::Arg::Optional, "" },
+            { JITTER_DURATION, 0, "", "jitter-duration", option::Arg::Optional, "" },
+            { PARALLEL_TESTS, 0, "", "parallel-tests", option::Arg::Optional, "" },
+            { DEBUGCON_BYTE_IO, 0, "", "debugcon-byte-io", option::Arg::Optional, "" },
+            { VIRTIO_CONSOLE, 0, "", "virtio-console", option::Arg::Optional, "" },
+            { BINARY_LOG, 0, "", "binary-log", option::Arg::Optional, "" },
+            { TRACE, 0, "", "trace", option::Arg::Optional, "" },
+            { SHMEM_LOG, 0, "", "shmem-log", option::Arg::Optional, "" },
 
             { 0, 0, nullptr, nullptr, nullptr, nullptr }
         };
@@ -117,6 +134,15 @@ namespace cmdline
             return option_value(optionparser::option_index::XHCI_POWER).value_or("0");
         }
 
+        /**
+         * Returns something if the xhci-single-transfer cmdline modifier
+         * (flag) is present.
+         */
+        std::optional<std::string> xhci_single_transfer_option()
+        {
+            return option_value(optionparser::option_index::XHCI_SINGLE_TRANSFER);
+        }
+
         /**
          * Returns the disable-testcases cmdline modifier or the default.
          */
@@ -126,6 +152,71 @@ namespace cmdline
             return util::string::split(disabled_testcases_str, cmdline::optionparser::DISABLED_TESTCASES_DELIMITER);
         }
 
+        /**
+         * Returns the jitter-duration cmdline modifier in seconds or the default.
+         */
+        std::string jitter_duration_option()
+        {
+            return option_value(optionparser::option_index::JITTER_DURATION).value_or("200");
+        }
+
+        /**
+         * Returns something if the parallel-tests cmdline modifier (flag) is
+         * present.
+         */
+        std::optional<std::string> parallel_tests_option()
+        {
+            return option_value(optionparser::option_index::PARALLEL_TESTS);
+        }
+
+        /**
+         * Returns something if the debugcon-byte-io cmdline modifier (flag)
+         * is present.
+         */
+        std::optional<std::string> debugcon_byte_io_option()
+        {
+            return option_value(optionparser::option_index::DEBUGCON_BYTE_IO);
+        }
+
+        /**
+         * Returns something if the virtio-console cmdline modifier (flag) is
+         * present.
+         */
+        std::optional<std::string> virtio_console_option()
+        {
+            return option_value(optionparser::option_index::VIRTIO_CONSOLE);
+        }
+
+        /**
+         * Returns something if the binary-log cmdline modifier (flag) is
+         * present.
+         */
+        std::optional<std::string> binary_log_option()
+        {
+            return option_value(optionparser::option_index::BINARY_LOG);
+        }
+
+        /**
+         * Returns the trace categories of the trace cmdline modifier, or
+         * nothing if it is not present.
+         */
+        std::vector<std::string> trace_option()
+        {
+            auto trace_str = option_value(optionparser::option_index::TRACE).value_or("");
+            return util::string::split(trace_str, cmdline::optionparser::TRACE_CATEGORIES_DELIMITER);
+        }
+
+        /**
+         * Returns something if the shmem-log cmdline modifier (flag or
+         * option) is present.
+         *
+         * If the modifier was provided as flag, the inner string is empty.
+         */
+        std::optional<std::string> shmem_log_option()
+        {
+            return option_value(optionparser::option_index::SHMEM_LOG);
+        }
+
      private:
         std::vector<std::string> arguments;
         std::vector<const char*> argv;
@@ -20,17 +20,33 @@ namespace debugcon
 {
     constexpr uint16_t IO_PORT = 0xe9;
 
+    /// With string I/O, the VMM can handle a whole line with one exit. VMMs that emulate it one byte at a time
+    /// are faster with plain OUTs.
+    inline bool use_string_io{ true };
+
     void putc(unsigned char c)
     {
         outb(IO_PORT, c);
     }
+
+    void write(const char* data, size_t size)
+    {
+        if (use_string_io) {
+            outsb(IO_PORT, data, size);
+            return;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            outb(IO_PORT, data[i]);
+        }
+    }
 }  // namespace debugcon
 
 namespace console_debugcon
 {
     static void init()
     {
-        add_printf_backend(debugcon::putc);
+        add_printf_backend(debugcon::putc, debugcon::write);
         info("Initialized QEMU debugcon console");
     }
 
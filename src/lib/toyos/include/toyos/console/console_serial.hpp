@@ -16,11 +16,23 @@
 #include "toyos/x86/arch.hpp"
 #include <config.hpp>
 
+/**
+ * 16550-compatible UART.
+ *
+ * Checking the line status before every byte costs a port I/O access per character, which is an exit in a VM. Once
+ * the transmitter is empty, as many bytes as fit into its FIFO are written without checking again.
+ */
 class console_serial_base : public console
 {
  protected:
     uint16_t base{ 0 };
 
+    size_t tx_fifo_depth{ 1 };  ///< bytes the transmitter can take at once, 1 without FIFO
+    size_t tx_budget{ 0 };      ///< bytes that can still be written before the line status has to be checked
+
+    /// Wait until the transmitter is empty. Returns false if it does not drain in time.
+    bool wait_for_transmitter();
+
  public:
     struct console_info
     {
@@ -78,6 +90,8 @@ class console_serial_base : public console
         IER_MASK = IER_RECV | IER_SEND | IER_STATUS,
 
         THB_DATA = 1u << 0,
+
+        TX_FIFO_DEPTH_16550A = 16,
     };
 
     console_serial_base(uint16_t port, unsigned);
@@ -85,10 +99,15 @@ class console_serial_base : public console
 
     virtual void puts(const std::string& str) override
     {
-        puts_default(str);
+        write(str.data(), str.size());
+    }
+
+    virtual void putc(char c) override
+    {
+        write(&c, 1);
     }
 
-    virtual void putc(char c) override;
+    virtual void write(const char* data, size_t size) override;
 };
 
 class console_serial final : public console_serial_base
@@ -103,6 +122,7 @@ class console_serial final : public console_serial_base
     }
 
     static void putchar(unsigned char c);
+    static void putstr(const char* data, size_t size);
 };
 
 struct bda_serial_config
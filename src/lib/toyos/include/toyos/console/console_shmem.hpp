@@ -0,0 +1,95 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "console.hpp"
+#include "console_shmem_util.hpp"
+#include "toyos/util/interval.hpp"
+#include "toyos/util/lock_free_queue.hpp"
+
+/*
+ * Output channel into memory that the host reads directly, so printing causes no VM exits at all.
+ *
+ * The memory holds a single-producer, single-consumer queue in the lock_less_queue_t layout (see
+ * toyos/util/lock_free_queue_def.h) whose entries are shmem::chunk. scripts/shmem-log-reader.py is the consumer on
+ * the host side.
+ *
+ * The memory is either the shared memory BAR of an ivshmem PCI device or a region given on the command line.
+ */
+namespace shmem
+{
+    enum
+    {
+        IVSHMEM_VENDOR_ID = 0x1af4,
+        IVSHMEM_DEVICE_ID = 0x1110,
+        IVSHMEM_SHARED_MEMORY_BAR = 2,
+    };
+
+    static constexpr size_t CHUNK_SIZE{ 128 };
+
+    /// A piece of output. Lines longer than a chunk are split across several chunks.
+    struct chunk
+    {
+        uint32_t size;  ///< Number of valid bytes in data.
+        char data[CHUNK_SIZE - sizeof(uint32_t)];
+    };
+    static_assert(sizeof(chunk) == CHUNK_SIZE);
+
+    /// Upper bound for the number of chunks. The actual number depends on the size of the memory.
+    static constexpr size_t MAX_CHUNKS{ 1 << 20 };
+
+    using producer = cbl::lock_free_queue_producer<chunk, MAX_CHUNKS>;
+}  // namespace shmem
+
+class console_shmem final : public console
+{
+ public:
+    /**
+     * Set up the queue in the given memory.
+     *
+     * \return false if the memory is too small, overlaps the loaded image or is not below 4 GiB, where it would not
+     *         be identity-mapped.
+     */
+    bool init(const cbl::interval& region);
+
+    virtual void puts(const std::string& str) override
+    {
+        write(str.data(), str.size());
+    }
+
+    virtual void putc(char c) override
+    {
+        write(&c, 1);
+    }
+
+    virtual void write(const char* data, size_t size) override;
+
+    static void putchar(unsigned char c);
+    static void putstr(const char* data, size_t size);
+
+ private:
+    /// Wait for the reader to make room. Returns false if it does not.
+    bool wait_for_space();
+
+    std::unique_ptr<shmem::producer> queue;
+
+    /// Set if the reader did not make room in time. Output is dropped without waiting until it does.
+    bool reader_stalled{ false };
+
+    /// Bytes that were dropped since the reader stalled.
+    size_t dropped{ 0 };
+};
+
+/**
+ * Use the given memory for printing.
+ *
+ * \return false if the memory cannot be used.
+ */
+bool shmem_console_init(const cbl::interval& region);
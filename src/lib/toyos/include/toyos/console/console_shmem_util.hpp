@@ -0,0 +1,26 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include <toyos/util/interval.hpp>
+
+namespace shmem
+{
+    /// Parse a region given as "<address>,<size>". Both numbers may be hexadecimal with 0x prefix.
+    std::optional<cbl::interval> parse_region(const std::string& str);
+
+    /**
+     * Check whether the queue can live in the given region.
+     *
+     * \param min_size the smallest region that holds the queue header and at least one usable chunk
+     * \param image the memory of the loaded image, which must not be overwritten
+     * \return false if the region is too small, overlaps the image or is not below 4 GiB, where it would not be
+     *         identity-mapped.
+     */
+    bool region_usable(const cbl::interval& region, size_t min_size, const cbl::interval& image);
+}  // namespace shmem
@@ -0,0 +1,197 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "console.hpp"
+#include "toyos/pci/device.hpp"
+#include "toyos/util/interval.hpp"
+
+/*
+ * Output-only driver for a virtio console behind a modern (virtio 1.0) PCI transport.
+ *
+ * Each write is copied into DMA buffers that are handed to the transmit queue of port 0 in one go, followed by a
+ * single notification. A VMM thus handles a whole line with one exit instead of one exit per byte. The receive queue
+ * is set up without buffers, because some VMMs only start a console once all of its queues are enabled.
+ *
+ * Specification: https://docs.oasis-open.org/virtio/virtio/v1.1/virtio-v1.1.html
+ */
+namespace virtio
+{
+    enum
+    {
+        PCI_VENDOR_ID = 0x1af4,
+        PCI_DEVICE_ID_CONSOLE = 0x1040 + 3,  ///< Modern devices use 0x1040 plus the virtio device ID.
+
+        CONSOLE_RECEIVE_QUEUE = 0,   ///< Receive queue of port 0.
+        CONSOLE_TRANSMIT_QUEUE = 1,  ///< Transmit queue of port 0.
+
+        STATUS_ACKNOWLEDGE = 1u << 0,
+        STATUS_DRIVER = 1u << 1,
+        STATUS_DRIVER_OK = 1u << 2,
+        STATUS_FEATURES_OK = 1u << 3,
+        STATUS_FAILED = 1u << 7,
+
+        FEATURE_VERSION_1_SELECT = 1,  ///< VIRTIO_F_VERSION_1 is feature bit 32, i.e. bit 0 of feature dword 1.
+        FEATURE_VERSION_1 = 1u << 0,
+
+        NO_MSIX_VECTOR = 0xffff,
+
+        AVAIL_F_NO_INTERRUPT = 1u << 0,
+    };
+
+#pragma pack(push, 1)
+    /// Vendor-specific PCI capability that locates one of the configuration structures in a BAR.
+    struct pci_cap : pci::vendor_capability
+    {
+        enum cfg_type : uint8_t
+        {
+            COMMON_CFG = 1,
+            NOTIFY_CFG = 2,
+            ISR_CFG = 3,
+            DEVICE_CFG = 4,
+            PCI_CFG = 5,
+        };
+
+        uint8_t type;
+        uint8_t bar;
+        uint8_t padding[3];
+        uint32_t offset;  ///< Offset of the structure within the BAR.
+        uint32_t length;  ///< Length of the structure in bytes.
+    };
+    static_assert(sizeof(pci_cap) == 16, "Wrong virtio capability layout!");
+
+    /// Notification capability, which also describes how the notification addresses of the queues are spaced.
+    struct pci_notify_cap : pci_cap
+    {
+        uint32_t notify_off_multiplier;
+    };
+
+    /// Common configuration structure. The 64-bit queue addresses are split, because the device only has to support
+    /// 32-bit accesses.
+    struct common_cfg
+    {
+        uint32_t device_feature_select;
+        uint32_t device_feature;
+        uint32_t driver_feature_select;
+        uint32_t driver_feature;
+        uint16_t msix_config;
+        uint16_t num_queues;
+        uint8_t device_status;
+        uint8_t config_generation;
+
+        uint16_t queue_select;
+        uint16_t queue_size;
+        uint16_t queue_msix_vector;
+        uint16_t queue_enable;
+        uint16_t queue_notify_off;
+        uint32_t queue_desc_lo;
+        uint32_t queue_desc_hi;
+        uint32_t queue_driver_lo;
+        uint32_t queue_driver_hi;
+        uint32_t queue_device_lo;
+        uint32_t queue_device_hi;
+    };
+    static_assert(sizeof(common_cfg) == 0x38, "Wrong virtio common configuration layout!");
+#pragma pack(pop)
+
+    /// Split virtqueue descriptor.
+    struct vq_desc
+    {
+        enum
+        {
+            F_NEXT = 1u << 0,
+            F_WRITE = 1u << 1,
+        };
+
+        uint64_t addr;
+        uint32_t len;
+        uint16_t flags;
+        uint16_t next;
+    };
+
+    /// Element of the used ring.
+    struct vq_used_elem
+    {
+        uint32_t id;
+        uint32_t len;
+    };
+
+}  // namespace virtio
+
+class console_virtio final : public console
+{
+ public:
+    /// Number of descriptors, each of which owns one buffer.
+    static constexpr size_t QUEUE_SIZE{ 16 };
+
+    /// Size of the buffer behind each descriptor. Longer writes use several descriptors.
+    static constexpr size_t BUFFER_SIZE{ 256 };
+
+    /// Pages the driver needs from the DMA pool: one for the rings of each queue, the rest for the buffers.
+    static constexpr size_t DMA_PAGES{ 2 + QUEUE_SIZE * BUFFER_SIZE / PAGE_SIZE };
+
+    /**
+     * Bring up the receive and transmit queues of the given device.
+     *
+     * \param dev        The virtio console PCI function.
+     * \param dma_region An identity-mapped region of at least DMA_PAGES pages.
+     * \return false if the device cannot be driven.
+     */
+    bool init(const pci_device& dev, const cbl::interval& dma_region);
+
+    virtual void puts(const std::string& str) override
+    {
+        write(str.data(), str.size());
+    }
+
+    virtual void putc(char c) override
+    {
+        write(&c, 1);
+    }
+
+    virtual void write(const char* data, size_t size) override;
+
+    static void putchar(unsigned char c);
+    static void putstr(const char* data, size_t size);
+
+ private:
+    /// Move descriptors the device is done with back to the free list.
+    void reap();
+
+    /// Take a descriptor from the free list, waiting for the device if there is none. Marks the device broken if it
+    /// does not return a descriptor in time.
+    std::optional<uint16_t> take_descriptor();
+
+    /// Make the queued descriptors visible to the device and notify it once for all of them.
+    void publish();
+
+    volatile uint16_t* notify_addr{ nullptr };
+
+    volatile virtio::vq_desc* desc{ nullptr };
+    volatile uint16_t* avail{ nullptr };  ///< flags, idx, ring[QUEUE_SIZE]
+    volatile uint16_t* used{ nullptr };   ///< flags, idx, followed by the used elements
+    char* buffers{ nullptr };
+
+    uint16_t queue_size{ 0 };
+    uint16_t avail_idx{ 0 };
+    uint16_t last_used_idx{ 0 };
+
+    uint16_t free_ids[QUEUE_SIZE]{};
+    uint16_t free_count{ 0 };
+
+    /// Set if the device stopped consuming output. All further output is dropped without waiting for it again.
+    bool broken{ false };
+};
+
+/**
+ * Use the given virtio console for printing.
+ *
+ * \return false if the device cannot be driven.
+ */
+bool virtio_console_init(const pci_device& dev, const cbl::interval& dma_region);
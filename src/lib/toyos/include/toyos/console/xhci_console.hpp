@@ -9,8 +9,9 @@
 class xhci_console_baremetal final : public xhci_console_base
 {
  public:
-    xhci_console_baremetal(const std::u16string& identifier, const cbl::interval& mmio_region, const cbl::interval& dma_region, xhci_debug_device::power_cycle_method power_method)
-        : xhci_console_base(std::make_unique<baremetal_device_driver_adapter>(dma_region), identifier, mmio_region, power_method)
+    xhci_console_baremetal(const std::u16string& identifier, const cbl::interval& mmio_region, const cbl::interval& dma_region, xhci_debug_device::power_cycle_method power_method,
+                           xhci_debug_device::transfer_mode mode)
+        : xhci_console_base(std::make_unique<baremetal_device_driver_adapter>(dma_region), identifier, mmio_region, power_method, mode)
     {}
 
     virtual void putc(char c) override
@@ -242,6 +242,17 @@ namespace pci
         uint32_t offset_pba;    ///< MSI-X pending bit array offset in the same BAR.
     };
 
+    /// Vendor-specific capability. Its layout after the length field is defined by the device.
+    struct vendor_capability : capability
+    {
+        enum
+        {
+            ID = 0x09,  ///< Vendor-specific capability ID.
+        };
+
+        uint8_t length;  ///< Length of the whole capability structure in bytes.
+    };
+
     struct sriov_capability : ext_capability
     {
         enum
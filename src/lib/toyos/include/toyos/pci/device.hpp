@@ -41,6 +41,9 @@ class pci_device
     enum masks
     {
         DEV_TYPE = math::mask(7),
+
+        COMMAND_MEMORY = 1u << 1,
+        COMMAND_BUS_MASTER = 1u << 2,
     };
 
  public:
@@ -50,6 +53,7 @@ class pci_device
     enum class offset
     {
         DEVICE_VENDOR_ID = 0x00,  ///< Device and Vendor identifier.
+        COMMAND = 0x04,           ///< Command and status register.
         CLASS = 0x08,             ///< Device class.
         BAR = 0x10,               ///< First BAR.
         HEADER_TYPE = 0x0c,       ///< PCI header type.
@@ -153,6 +157,13 @@ class pci_device
         return class_code() == PCI_CLASS_SIMPLE_COMM and subclass() == PCI_SUBCLASS_SERIAL;
     }
 
+    /// Lets the device decode its memory BARs and access memory on its own. Only the command half is written,
+    /// because the status half contains write-1-to-clear bits.
+    void enable_memory_and_bus_master() const
+    {
+        *ptr<uint16_t>(uintptr_t(offset::COMMAND)) |= COMMAND_MEMORY | COMMAND_BUS_MASTER;
+    }
+
     using bar_t = pci::bar_t;  ///< Alias to the BAR structure.
 
     /// Returns a pointer to BAR i.
@@ -161,11 +172,12 @@ class pci_device
         return reinterpret_cast<bar_t*>(uintptr_t(cfg_base_) + uintptr_t(offset::BAR) + i * sizeof(uint32_t));
     }
 
-    using capability = pci::capability;              ///< Alias to the capability structure.
-    using ext_capability = pci::ext_capability;      ///< Alias to the capability structure.
-    using msi_capability = pci::msi_capability;      ///< Alias to the MSI capability structure.
-    using msix_capability = pci::msix_capability;    ///< Alias to the MSI-X capability structure.
-    using sriov_capability = pci::sriov_capability;  ///< Alias to the SR-IOV capability structure.
+    using capability = pci::capability;                ///< Alias to the capability structure.
+    using ext_capability = pci::ext_capability;        ///< Alias to the capability structure.
+    using msi_capability = pci::msi_capability;        ///< Alias to the MSI capability structure.
+    using msix_capability = pci::msix_capability;      ///< Alias to the MSI-X capability structure.
+    using sriov_capability = pci::sriov_capability;    ///< Alias to the SR-IOV capability structure.
+    using vendor_capability = pci::vendor_capability;  ///< Alias to the vendor-specific capability structure.
 
  protected:
     class bar_iterator
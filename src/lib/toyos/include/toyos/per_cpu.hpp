@@ -0,0 +1,73 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <config.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace smp
+{
+
+    /// Counters that are only ever written by their own CPU.
+    struct per_cpu_stats
+    {
+        uint64_t arena_allocations;  ///< allocations served by the heap arena of the CPU
+        uint64_t heap_allocations;   ///< allocations that fell back to the global heap
+        uint64_t remote_frees;       ///< frees of memory from the heap arena of another CPU
+    };
+
+    /**
+     * \brief Data that every CPU has for itself.
+     *
+     * The GS base of each CPU points to its area, so it can be reached with a single memory access and without knowing
+     * the number of the CPU.
+     *
+     * The areas are set up before global constructors run, so this type must not have a non-trivial constructor.
+     */
+    struct alignas(CPU_CACHE_LINE_SIZE) per_cpu
+    {
+        /// Points to this area. Must be the first member, so this_cpu() can read it via %gs:0.
+        per_cpu* self;
+
+        /// Number of the CPU as used by the smp namespace.
+        size_t cpu;
+
+        /// Space for callers that need a few words of CPU-local memory without synchronization.
+        std::array<uint64_t, 8> scratch;
+
+        per_cpu_stats stats;
+    };
+
+    static_assert(std::is_trivially_default_constructible_v<per_cpu>);
+
+    /// Per-CPU area of the CPU we are running on.
+    inline per_cpu& this_cpu()
+    {
+        per_cpu* area;
+        asm volatile("mov %%gs:0, %0" : "=r"(area));
+        return *area;
+    }
+
+    /// Per-CPU area of the given CPU.
+    per_cpu& cpu_area(size_t cpu);
+
+    /**
+     * \brief Allocate memory from the heap arena of the current CPU.
+     *
+     * \return the allocated memory or nullptr if the CPU has no arena or it is exhausted
+     */
+    void* arena_alloc(size_t size);
+
+    /**
+     * \brief Return memory to the heap arena it was allocated from.
+     *
+     * \return false if the memory does not belong to any heap arena
+     */
+    bool arena_free(void* p);
+
+}  // namespace smp
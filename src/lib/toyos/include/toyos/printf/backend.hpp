@@ -3,16 +3,25 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 #pragma once
 
+#include <stddef.h>
+
 using printf_backend_fn = void (*)(unsigned char);
+using printf_bulk_backend_fn = void (*)(const char*, size_t);
 
 #ifdef PRINTF_BACKENDS_DISABLED
 
-static inline void add_printf_backend(printf_backend_fn)
+static inline void add_printf_backend(printf_backend_fn, printf_bulk_backend_fn = nullptr)
 {}
 static inline void remove_printf_backend(printf_backend_fn)
 {}
 static inline void remove_all_printf_backends()
 {}
+static inline void flush_printf_backends()
+{}
+static inline void print_record_to_all_backends(const char*, size_t)
+{}
+static inline void print_string_to_all_backends(const char*, size_t)
+{}
 
 #else
 
@@ -20,8 +29,29 @@ static inline void remove_all_printf_backends()
 ///
 /// Normal printing functions, such as printf, will call this function for every character they need to print. This
 /// function does not do anything in a hosted environment as all output goes via the normal libc.
-void add_printf_backend(printf_backend_fn backend);
+///
+/// If the backend can print several characters at once, it should provide a bulk backend as well, which is then used
+/// instead.
+void add_printf_backend(printf_backend_fn backend, printf_bulk_backend_fn bulk_backend = nullptr);
 void remove_printf_backend(printf_backend_fn backend);
 void remove_all_printf_backends();
 
+/// Print a character to all registered backends. This is the default output function of xprintf.
+///
+/// Output is buffered per CPU and passed to the backends when a line is complete, the buffer is full or
+/// flush_printf_backends() is called. It is safe to print from several CPUs at once, lines of different CPUs do not
+/// interleave.
+void print_to_all_backends(unsigned char c);
+
+/// Print several characters to all registered backends. This is the bulk output function of xprintf and behaves like
+/// calling print_to_all_backends() for each character.
+void print_string_to_all_backends(const char* data, size_t size);
+
+/// Pass an incomplete line of the current CPU to the backends. Call this before the system stops.
+void flush_printf_backends();
+
+/// Print a block of binary data that must not be split up or interleaved with output of other CPUs, such as a
+/// binary log record. It is at most binlog::MAX_RECORD_SIZE bytes long.
+void print_record_to_all_backends(const char* data, size_t size);
+
 #endif
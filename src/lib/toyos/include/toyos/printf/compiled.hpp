@@ -0,0 +1,307 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <toyos/printf/format_string.hpp>
+#include <toyos/printf/xprintf.h>
+
+/**
+ * \brief Format strings that are parsed at compile time.
+ *
+ * pprintf() turns the {} placeholders into a printf format string at compile time, but xprintf still walks that
+ * string character by character for every call. pprintf_compiled() also splits the format string at compile time,
+ * following the rules of xprintf. At runtime, the literal parts are written in one go and each argument is
+ * converted according to its real type instead of being fetched with va_arg.
+ *
+ * Arguments that do not match their conversion, or a number of arguments that does not match the format string,
+ * are compile errors.
+ */
+namespace compiled_format
+{
+    /// A part of the format string: either a literal range or a conversion that consumes one argument.
+    struct segment
+    {
+        enum kind_t
+        {
+            LITERAL,
+            ARGUMENT,
+        };
+
+        kind_t kind{ LITERAL };
+        bool prefix{ false };  ///< The '#' flag, which makes xprintf print "0x" before anything else.
+
+        // LITERAL
+        size_t begin{ 0 };
+        size_t end{ 0 };
+
+        // ARGUMENT
+        char conversion{ 0 };  ///< Conversion character as written, i.e. 'x' and 'X' differ.
+        unsigned flags{ 0 };   ///< FLAG_ZERO_PADDING, FLAG_LEFT_JUSTIFIED and the size flags.
+        unsigned width{ 0 };
+
+        static constexpr segment literal(size_t begin_, size_t end_, bool prefix_ = false)
+        {
+            segment s;
+            s.prefix = prefix_;
+            s.begin = begin_;
+            s.end = end_;
+            return s;
+        }
+    };
+
+    /// Conversion character in upper case, as xprintf compares it.
+    constexpr char upper(char c)
+    {
+        return c >= 'a' ? static_cast<char>(c - 0x20) : c;
+    }
+
+    /// Call fn for every segment of the format string, in the same way as xvprintf_internal() processes it.
+    template<typename FN>
+    constexpr void for_each_segment(const char* fmt, FN&& fn)
+    {
+        size_t i{ 0 };
+        size_t literal_begin{ 0 };
+
+        while (fmt[i]) {
+            if (fmt[i] != '%') {
+                i++;
+                continue;
+            }
+
+            if (i > literal_begin) {
+                fn(segment::literal(literal_begin, i));
+            }
+            i++;
+
+            segment seg;
+            seg.kind = segment::ARGUMENT;
+
+            char c{ fmt[i++] };
+            if (c == '#') {
+                seg.prefix = true;
+                c = fmt[i++];
+            }
+
+            if (c == '0') {
+                seg.flags = FLAG_ZERO_PADDING;
+                c = fmt[i++];
+            }
+            else if (c == '-') {
+                seg.flags = FLAG_LEFT_JUSTIFIED;
+                c = fmt[i++];
+            }
+
+            for (; c >= '0' and c <= '9'; c = fmt[i++]) {
+                seg.width = seg.width * 10 + static_cast<unsigned>(c - '0');
+            }
+
+            if (c == 'l' or c == 'L') {
+                seg.flags |= FLAG_SIZE_LONG;
+                c = fmt[i++];
+            }
+            if (c == 'l' or c == 'L') {
+                seg.flags |= FLAG_SIZE_LONG_LONG;
+                c = fmt[i++];
+            }
+
+            if (not c) {
+                // A dangling conversion ends the format string.
+                if (seg.prefix) {
+                    fn(segment::literal(0, 0, true));
+                }
+                return;
+            }
+
+            switch (upper(c)) {
+                case 'S':
+                case 'C':
+                case 'B':
+                case 'O':
+                case 'D':
+                case 'U':
+                case 'P':
+                case 'X':
+                    seg.conversion = c;
+                    fn(seg);
+                    break;
+                default:
+                    // Unknown conversions print themselves, which also turns "%%" into "%".
+                    fn(segment::literal(i - 1, i, seg.prefix));
+                    break;
+            }
+
+            literal_begin = i;
+        }
+
+        if (i > literal_begin) {
+            fn(segment::literal(literal_begin, i));
+        }
+    }
+
+    /// The segments of a format string, see format_string.
+    template<typename FORMAT>
+    struct program
+    {
+        static constexpr const char* format{ FORMAT::value };
+
+        static constexpr size_t count()
+        {
+            size_t n{ 0 };
+            for_each_segment(format, [&n](const segment&) { n++; });
+            return n;
+        }
+
+        static constexpr size_t SIZE{ count() };
+
+        static constexpr std::array<segment, SIZE> parse()
+        {
+            std::array<segment, SIZE> result{};
+            size_t n{ 0 };
+            for_each_segment(format, [&result, &n](const segment& s) { result[n++] = s; });
+            return result;
+        }
+
+        static constexpr std::array<segment, SIZE> segments{ parse() };
+    };
+
+    /// Enums are printed as their underlying type, as they would be when passed through varargs.
+    template<typename T, bool = std::is_enum_v<T>>
+    struct integer
+    {
+        using type = T;
+    };
+
+    template<typename T>
+    struct integer<T, true>
+    {
+        using type = std::underlying_type_t<T>;
+    };
+
+    template<typename PROGRAM, size_t SEG>
+    void put_literal()
+    {
+        constexpr segment seg{ PROGRAM::segments[SEG] };
+
+        if constexpr (seg.prefix) {
+            xputs_n("0x", 2);
+        }
+        if constexpr (seg.end > seg.begin) {
+            xputs_n(PROGRAM::format + seg.begin, seg.end - seg.begin);
+        }
+    }
+
+    template<typename PROGRAM, size_t SEG, typename T>
+    void put_argument(const T& value)
+    {
+        constexpr segment seg{ PROGRAM::segments[SEG] };
+        constexpr char conversion{ upper(seg.conversion) };
+        using arg_t = std::decay_t<T>;
+
+        if constexpr (seg.prefix) {
+            xputs_n("0x", 2);
+        }
+
+        if constexpr (conversion == 'S') {
+            static_assert(std::is_same_v<arg_t, char*> or std::is_same_v<arg_t, const char*>,
+                          "%s needs a string argument");
+            xput_string(value, seg.flags, seg.width);
+        }
+        else if constexpr (conversion == 'C') {
+            static_assert(std::is_integral_v<arg_t>, "%c needs a character argument");
+            const char c{ static_cast<char>(+value) };
+            xputs_n(&c, 1);
+        }
+        else if constexpr (conversion == 'P') {
+            static_assert(std::is_pointer_v<arg_t> or std::is_null_pointer_v<arg_t>, "%p needs a pointer argument");
+            xputs_n("0x", 2);
+            if constexpr (std::is_null_pointer_v<arg_t>) {
+                xput_number(0, 16, seg.flags | FLAG_SIZE_POINTER, seg.width, false);
+            }
+            else {
+                xput_number(reinterpret_cast<uintptr_t>(value), 16, seg.flags | FLAG_SIZE_POINTER, seg.width, false);
+            }
+        }
+        else {
+            using int_t = typename integer<arg_t>::type;
+            static_assert(std::is_integral_v<int_t>, "Numeric conversions need an integer argument");
+
+            // Integer promotion gives the type xprintf would have fetched with va_arg.
+            using promoted_t = decltype(+static_cast<int_t>(value));
+
+            if constexpr (conversion == 'D') {
+                const std::make_signed_t<promoted_t> signed_value = static_cast<int_t>(value);
+                const long long wide_value = signed_value;
+                unsigned long long magnitude = wide_value;
+                unsigned flags{ seg.flags };
+                if (wide_value < 0) {
+                    magnitude = 0 - magnitude;
+                    flags |= FLAG_SIGNED_NEGATIVE;
+                }
+                xput_number(magnitude, 10, flags, seg.width, false);
+            }
+            else {
+                constexpr unsigned radix{ conversion == 'B' ? 2u : conversion == 'O' ? 8u : conversion == 'X' ? 16u : 10u };
+                const std::make_unsigned_t<promoted_t> unsigned_value = static_cast<int_t>(value);
+                xput_number(unsigned_value, radix, seg.flags, seg.width, seg.conversion == 'x');
+            }
+        }
+    }
+
+    template<typename PROGRAM, size_t SEG>
+    void run()
+    {
+        if constexpr (SEG < PROGRAM::SIZE) {
+            static_assert(PROGRAM::segments[SEG].kind == segment::LITERAL,
+                          "The format string has more conversions than arguments");
+            put_literal<PROGRAM, SEG>();
+            run<PROGRAM, SEG + 1>();
+        }
+    }
+
+    template<typename PROGRAM, size_t SEG, typename T, typename... REST>
+    void run(const T& arg, const REST&... rest)
+    {
+        static_assert(SEG < PROGRAM::SIZE, "The format string has fewer conversions than arguments");
+
+        if constexpr (SEG < PROGRAM::SIZE) {
+            if constexpr (PROGRAM::segments[SEG].kind == segment::LITERAL) {
+                put_literal<PROGRAM, SEG>();
+                run<PROGRAM, SEG + 1>(arg, rest...);
+            }
+            else {
+                put_argument<PROGRAM, SEG>(arg);
+                run<PROGRAM, SEG + 1>(rest...);
+            }
+        }
+    }
+
+    template<typename FORMAT, typename... ARGS>
+    void print(const ARGS&... args)
+    {
+        run<program<FORMAT>, 0>(args...);
+    }
+}  // namespace compiled_format
+
+/**
+ * Like pprintf(), but the format string is split into literals and conversions at compile time.
+ *
+ * Output goes through the same backends as printf().
+ */
+#define pprintf_compiled(fmtstr, ...)                                                                      \
+    do {                                                                                                   \
+        struct strprov                                                                                     \
+        {                                                                                                  \
+            static constexpr const char* str()                                                             \
+            {                                                                                              \
+                return fmtstr;                                                                             \
+            }                                                                                              \
+        };                                                                                                 \
+        using __compiled_args__ = decltype(pprintpp::tie_types(__VA_ARGS__));                              \
+        compiled_format::print<compiled_format::format_string_t<strprov, __compiled_args__>>(__VA_ARGS__); \
+    } while (0)
@@ -0,0 +1,28 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <pprintpp/pprintpp.hpp>
+
+namespace compiled_format
+{
+    /**
+     * Turns the character list pprintpp produces into a string that is available at compile time.
+     *
+     * pprintpp itself only hands out the printf format string through a non-constexpr function.
+     */
+    template<typename LIST>
+    struct format_string;
+
+    template<char... CHARS>
+    struct format_string<charlist::char_tl<CHARS...>>
+    {
+        static constexpr char value[]{ CHARS..., '\0' };
+        static constexpr size_t length{ sizeof...(CHARS) };
+    };
+
+    /// The format string pprintpp makes out of the string of STRPROV for arguments of the types in ARG_LIST.
+    template<typename STRPROV, typename ARG_LIST>
+    using format_string_t = format_string<typename pprintpp::autoformat_t<STRPROV, ARG_LIST>::list>;
+}  // namespace compiled_format
@@ -22,6 +22,10 @@ extern "C"
 #define xdev_out(func) xfunc_out = func
     extern void (*xfunc_out)(unsigned char);
 
+/* Optional output function for several characters at once. */
+#define xdev_out_bulk(func) xfunc_out_bulk = func
+    extern void (*xfunc_out_bulk)(const char*, unsigned long);
+
 #ifndef LIB_TYPE_HOSTED
     int putc(char c);
     int putchar(int c);
@@ -33,6 +37,24 @@ extern "C"
     int snprintf(char* buff, unsigned long n, const char* fmt, ...);
     int vsnprintf(char* buff, unsigned long n, const char* fmt, va_list arp);
 
+    /* Building blocks for printing with format strings that were parsed at compile time. */
+    enum
+    {
+        FLAG_ZERO_PADDING = 1u << 0,
+        FLAG_LEFT_JUSTIFIED = 1u << 1,
+        FLAG_SIZE_LONG = 1u << 2,
+        FLAG_SIZE_LONG_LONG = 1u << 3,
+        FLAG_SIGNED_NEGATIVE = 1u << 4,
+        FLAG_SIZE_POINTER = 1u << 5,
+    };
+
+    /* Put len characters. */
+    void xputs_n(const char* str, unsigned long len);
+    /* Put a string, padded to width w. */
+    void xput_string(const char* str, unsigned int f, unsigned int w);
+    /* Put the absolute value v of a number in radix r, padded to width w. */
+    void xput_number(unsigned long long v, unsigned int r, unsigned int f, unsigned int w, int lowercase);
+
 #define DW_CHAR sizeof(char)
 #define DW_SHORT sizeof(short)
 #define DW_LONG sizeof(long)
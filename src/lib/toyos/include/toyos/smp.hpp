@@ -0,0 +1,92 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+/**
+ * \brief Support for multiple processors.
+ *
+ * After smp::init(), all enabled processors listed in the MADT are running. Application processors (APs) wait for
+ * work that is handed to them with start_on() or run_on(). APs run with interrupts disabled, their own GDT, TSS and
+ * stack, and share global_idt with the bootstrap processor (BSP).
+ *
+ * CPUs are numbered consecutively, the BSP is CPU 0.
+ *
+ * The heap and printing can be used from all CPUs.
+ */
+namespace smp
+{
+    /// Maximum number of CPUs that are brought up.
+    static constexpr size_t MAX_CPUS{ 64 };
+
+    /**
+     * \brief Boot all APs.
+     *
+     * Only the first call has an effect. Must be called on the BSP with the LAPIC in xAPIC mode.
+     */
+    void init();
+
+    /// Number of online CPUs including the BSP.
+    size_t cpu_count();
+
+    /// Number of the CPU we are running on.
+    size_t current_cpu();
+
+    /// APIC ID of the given CPU.
+    uint32_t apic_id(size_t cpu);
+
+    /**
+     * \brief Let the given AP execute a function.
+     *
+     * The function object has to stay alive until wait_for() returned for this AP.
+     *
+     * \param cpu number of an idle AP
+     * \param fn function to execute
+     */
+    void start_on(size_t cpu, const std::function<void()>& fn);
+
+    /// Wait until the given AP finished its current function.
+    void wait_for(size_t cpu);
+
+    /**
+     * \brief Execute fn(i) on cpus[i] for every i and wait until all are done.
+     *
+     * The functions start at the same time. The BSP takes part if it is in the list, all other CPUs have to be idle
+     * APs.
+     */
+    void run_together(const std::vector<size_t>& cpus, const std::function<void(size_t)>& fn);
+
+    /**
+     * \brief Execute a function on the given AP and wait for its result.
+     *
+     * \param cpu number of an idle AP
+     * \param fn function to execute
+     * \return the result of fn
+     */
+    template<typename FN>
+    auto run_on(size_t cpu, FN fn)
+    {
+        using result_t = decltype(fn());
+
+        // Only capture references, so the std::function does not need to allocate.
+        if constexpr (std::is_void_v<result_t>) {
+            const std::function<void()> work{ [&fn] { fn(); } };
+            start_on(cpu, work);
+            wait_for(cpu);
+        }
+        else {
+            std::optional<result_t> result;
+            const std::function<void()> work{ [&result, &fn] { result = fn(); } };
+            start_on(cpu, work);
+            wait_for(cpu);
+            return *result;
+        }
+    }
+}  // namespace smp
@@ -18,6 +18,8 @@ namespace lapic_test_tools
     constexpr uintptr_t LAPIC_TPR{ 0xfee00080 };
     constexpr uintptr_t LAPIC_PPR{ 0xfee000a0 };
     constexpr uintptr_t LAPIC_EOI{ 0xfee000b0 };
+    constexpr uintptr_t LAPIC_LDR{ 0xfee000d0 };
+    constexpr uintptr_t LAPIC_DFR{ 0xfee000e0 };
     constexpr uintptr_t LAPIC_SVR{ 0xfee000f0 };
     constexpr uintptr_t ISR_0_31{ 0xfee00100 };
     constexpr uintptr_t ISR_32_63{ 0xfee00110 };
@@ -157,6 +159,12 @@ namespace lapic_test_tools
         EXTINT = 7,
     };
 
+    enum class apic_mode
+    {
+        XAPIC,
+        X2APIC,
+    };
+
     /// Pin polarity.
     enum class lvt_pin_polarity : uint32_t
     {
@@ -237,6 +245,11 @@ namespace lapic_test_tools
 
     uint32_t ticks_per_second(uint32_t divisor);
 
+    /**
+     * \brief Returns the TSC frequency, calibrated once against the RTC.
+     */
+    uint64_t tsc_ticks_per_second();
+
     void enable_periodic_timer(uint32_t interrupt_vector, uint32_t time_in_ms);
 
     /**
@@ -271,6 +284,28 @@ namespace lapic_test_tools
  */
     [[nodiscard]] bool software_apic_enabled();
 
+    /**
+ * \brief Compose the 64-bit ICR value of an IPI.
+ *
+ * The destination is only used without shorthand. It is an 8-bit APIC ID or
+ * logical destination in xAPIC mode and a 32-bit one in x2APIC mode.
+ */
+    uint64_t icr_value(uint8_t vector, uint32_t destination, dest_sh sh = dest_sh::NO_SH, dest_mode dest = dest_mode::PHYSICAL, lvt_dlv_mode dlv = lvt_dlv_mode::FIXED, apic_mode mode = apic_mode::XAPIC);
+
+    /**
+ * \brief Send the IPI described by an ICR value without further checks.
+ *
+ * In xAPIC mode, this waits until the IPI was delivered.
+ */
+    void write_icr(uint64_t icr, apic_mode mode = apic_mode::XAPIC);
+
+    /**
+ * \brief Send an IPI via the ICR.
+ *
+ * The destination is only used without shorthand.
+ */
+    void send_ipi(uint8_t vector, uint32_t destination, dest_sh sh = dest_sh::NO_SH, dest_mode dest = dest_mode::PHYSICAL, lvt_dlv_mode dlv = lvt_dlv_mode::FIXED, apic_mode mode = apic_mode::XAPIC);
+
     void send_self_ipi(uint8_t vector, dest_sh sh = dest_sh::SELF, dest_mode dest = dest_mode::PHYSICAL, lvt_dlv_mode dlv = lvt_dlv_mode::FIXED);
 
     bool check_irr(uint8_t vector);
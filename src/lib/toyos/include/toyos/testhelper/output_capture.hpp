@@ -0,0 +1,61 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <string>
+
+#include <toyos/printf/backend.hpp>
+
+/* A RAII-Style class that registers an additional printf backend, which collects everything printed while it is
+ * alive. Output still reaches all other backends as well.
+ *
+ * Only one capture can be active at a time.
+ */
+class output_capture
+{
+ public:
+    output_capture()
+    {
+        active = this;
+        add_printf_backend(capture_char, capture_string);
+    }
+
+    ~output_capture()
+    {
+        flush_printf_backends();
+        remove_printf_backend(capture_char);
+        active = nullptr;
+    }
+
+    output_capture(const output_capture&) = delete;
+    output_capture& operator=(const output_capture&) = delete;
+
+    /// Everything printed so far, including an incomplete line of the current CPU.
+    const std::string& output()
+    {
+        flush_printf_backends();
+        return captured;
+    }
+
+    void clear()
+    {
+        flush_printf_backends();
+        captured.clear();
+    }
+
+ private:
+    static void capture_char(unsigned char c)
+    {
+        active->captured.push_back(static_cast<char>(c));
+    }
+
+    static void capture_string(const char* data, size_t size)
+    {
+        active->captured.append(data, size);
+    }
+
+    static inline output_capture* active{ nullptr };
+
+    std::string captured;
+};
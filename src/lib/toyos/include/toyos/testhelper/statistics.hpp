@@ -3,9 +3,11 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 #pragma once
 
+#include "../util/trace.hpp"
 #include "../x86/x86asm.hpp"
 
 #include "algorithm"
+#include "array"
 #include "numeric"
 #include "vector"
 
@@ -77,10 +79,11 @@ namespace statistics
  *
  * \param f function to execute
  * \param times number of repetitions
+ * \param clock time stamp source, rdtsc can be used where rdtscp is unavailable
  * \return data set consisting of min/avg/max
  */
-    template<typename FN>
-    data<uint64_t> measure_cycles(FN f, size_t times = 1, size_t warmup_runs = 10)
+    template<typename FN, typename CLOCK = uint64_t (*)()>
+    data<uint64_t> measure_cycles(FN f, size_t times = 1, size_t warmup_runs = 10, CLOCK clock = rdtscp)
     {
         ASSERT(times > 0, "cannot measure zero runs");
 
@@ -92,9 +95,9 @@ namespace statistics
         }
 
         for (size_t run{ 0 }; run < times; ++run) {
-            auto start{ rdtscp() };
+            auto start{ clock() };
             f();
-            auto end{ rdtscp() };
+            auto end{ clock() };
 
             benchmark_data.push(end - start);
         }
@@ -133,4 +136,48 @@ namespace statistics
         data<uint64_t> res;
     };
 
+    /**
+ * A histogram with logarithmic buckets.
+ * Bucket i counts values of [2^i, 2^(i+1)), the last bucket is open-ended.
+ * In contrast to data, it does not allocate and can hence record an
+ * arbitrary number of values.
+ */
+    class log2_histogram
+    {
+     public:
+        static constexpr size_t BUCKETS{ 32 };
+
+        void record(uint64_t value)
+        {
+            size_t bucket{ 0 };
+            while (value > 1 and bucket < BUCKETS - 1) {
+                value >>= 1;
+                bucket++;
+            }
+            buckets[bucket]++;
+            count_++;
+        }
+
+        /// number of recorded values
+        uint64_t count() const
+        {
+            return count_;
+        }
+
+        /// print all non-empty buckets
+        void print(const char* unit) const
+        {
+            for (size_t bucket{ 0 }; bucket < BUCKETS; bucket++) {
+                if (buckets[bucket] == 0) {
+                    continue;
+                }
+                info(" >= {10} {s}: {}", 1ul << bucket, unit, buckets[bucket]);
+            }
+        }
+
+     private:
+        std::array<uint64_t, BUCKETS> buckets{};
+        uint64_t count_{ 0 };
+    };
+
 }  // namespace statistics
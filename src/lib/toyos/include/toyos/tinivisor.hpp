@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <functional>
 
+#include <toyos/util/cast_helpers.hpp>
 #include <toyos/x86/vmcs.hpp>
 
 /**
@@ -76,6 +77,28 @@ class tinivisor
      */
     __NOINLINE__ void stop();
 
+    /**
+     * \brief Hypercalls understood by tinivisor.
+     *
+     * The hypercall number is passed in rax when executing VMCALL.
+     */
+    enum class hypercall : uint64_t
+    {
+        STOP = 0,  ///< Leave VMX operation, used by stop().
+        NOP = 1,   ///< Return to the guest right away.
+    };
+
+    /**
+     * \brief Perform a hypercall that does nothing.
+     *
+     * The VMCALL handler only skips the instruction and resumes the guest. Hence, this is a complete VM exit and
+     * entry round trip without any further exit handling.
+     */
+    static void hypercall_nop()
+    {
+        asm volatile("vmcall" ::"a"(to_underlying(hypercall::NOP)) : "memory");
+    }
+
     /**
      * \brief Signature of a VM exit handler.
      *
@@ -91,7 +114,7 @@ class tinivisor
      * \param handler pointer to handler function
      *
      * Note that your handler might have to adjust the guest's instruction pointer.
-     * The VMCALL exit is used to shut down tinivisor and registering a handler for VMCALL is forbidden.
+     * The VMCALL exit is used for tinivisor's hypercalls and registering a handler for VMCALL is forbidden.
      */
     static void register_handler(x86::vmx_exit_reason reason, const handler_func& handler)
     {
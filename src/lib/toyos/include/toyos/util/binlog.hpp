@@ -0,0 +1,213 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <toyos/printf/backend.hpp>
+#include <toyos/printf/format_string.hpp>
+
+/**
+ * \brief Compact binary log records.
+ *
+ * Instead of formatting a message, a call site only sends its ID and the raw values of its arguments. The ID is the
+ * address of a descriptor in the .trace_sites ELF section, which holds pointers to the (already converted) printf
+ * format string, the file name, the log level and the argument types. scripts/binlog-decode.py turns the records
+ * back into text using the ELF file of the test.
+ *
+ * A record looks like this:
+ *
+ *     RECORD_MARKER | VERSION | payload length | site ID (32-bit, little endian) | arguments...
+ *
+ * Integers are encoded as LEB128, signed ones zigzag-encoded first. Strings are a LEB128 length followed by the
+ * characters. Text output can be freely mixed with records, as long as it does not contain RECORD_MARKER.
+ *
+ * Each descriptor is 40 bytes long:
+ *
+ *     format (u64) | file (u64) | level (u64) | argument types (u64) | line (u64)
+ *
+ * Argument types is a string with one character per argument: i (signed), u (unsigned) or s (string).
+ */
+namespace binlog
+{
+    /// Whether info() and friends send records instead of text.
+    inline bool enabled{ false };
+
+    static constexpr uint8_t RECORD_MARKER{ 0x1e };  ///< ASCII record separator
+    static constexpr uint8_t VERSION{ 1 };
+
+    static constexpr size_t HEADER_SIZE{ 3 };
+    static constexpr size_t MAX_RECORD_SIZE{ 128 };
+
+    /// Type character of an argument as it appears in the descriptor.
+    template<typename T>
+    constexpr char arg_type()
+    {
+        if constexpr (std::is_same_v<T, char*> or std::is_same_v<T, const char*>) {
+            return 's';
+        }
+        else if constexpr (std::is_signed_v<T>) {
+            return 'i';
+        }
+        else {
+            static_assert(std::is_integral_v<T> or std::is_pointer_v<T> or std::is_null_pointer_v<T>,
+                          "Unsupported argument type for binary logging");
+            return 'u';
+        }
+    }
+
+    template<typename... ARGS>
+    struct signature
+    {
+        static constexpr char value[]{ arg_type<ARGS>()..., '\0' };
+    };
+
+    /// Only used in unevaluated context to get the signature of a list of arguments.
+    template<typename... ARGS>
+    signature<std::decay_t<ARGS>...> signature_of(const ARGS&...);
+
+    /// A record under construction. If the arguments do not fit, the record is marked as overflowed.
+    class record
+    {
+     public:
+        explicit record(uint32_t site)
+        {
+            put(RECORD_MARKER);
+            put(VERSION);
+            put(0);  // payload length, fixed up in data()
+            for (size_t i = 0; i < sizeof(site); i++) {
+                put(static_cast<uint8_t>(site >> (8 * i)));
+            }
+        }
+
+        void add_unsigned(uint64_t value)
+        {
+            do {
+                const auto byte{ static_cast<uint8_t>(value & 0x7f) };
+                value >>= 7;
+                put(byte | (value ? 0x80 : 0));
+            } while (value);
+        }
+
+        void add_signed(int64_t value)
+        {
+            add_unsigned((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+        }
+
+        void add_string(const char* str)
+        {
+            const size_t length{ str ? strlen(str) : 0 };
+            add_unsigned(length);
+            if (length > MAX_RECORD_SIZE - size_) {
+                overflow_ = true;
+                return;
+            }
+            memcpy(buffer_ + size_, str, length);
+            size_ += length;
+        }
+
+        template<typename T>
+        void add(const T& value)
+        {
+            using arg_t = std::decay_t<T>;
+            constexpr char type{ arg_type<arg_t>() };
+            if constexpr (type == 's') {
+                add_string(value);
+            }
+            else if constexpr (type == 'i') {
+                add_signed(value);
+            }
+            else if constexpr (std::is_pointer_v<arg_t>) {
+                add_unsigned(reinterpret_cast<uintptr_t>(value));
+            }
+            else if constexpr (std::is_null_pointer_v<arg_t>) {
+                add_unsigned(0);
+            }
+            else {
+                add_unsigned(value);
+            }
+        }
+
+        bool overflowed() const
+        {
+            return overflow_;
+        }
+
+        const char* data()
+        {
+            buffer_[2] = static_cast<char>(size_ - HEADER_SIZE);
+            return buffer_;
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+     private:
+        void put(uint8_t byte)
+        {
+            if (size_ == MAX_RECORD_SIZE) {
+                overflow_ = true;
+                return;
+            }
+            buffer_[size_++] = static_cast<char>(byte);
+        }
+
+        char buffer_[MAX_RECORD_SIZE];
+        size_t size_{ 0 };
+        bool overflow_{ false };
+    };
+
+    /**
+     * Send a record for the given call site.
+     *
+     * \return false if the arguments do not fit into a record. The caller should print the message as text then.
+     */
+    template<typename... ARGS>
+    bool emit(uintptr_t site, const ARGS&... args)
+    {
+        record rec{ static_cast<uint32_t>(site) };
+        (rec.add(args), ...);
+
+        if (rec.overflowed()) {
+            return false;
+        }
+
+        print_record_to_all_backends(rec.data(), rec.size());
+        return true;
+    }
+}  // namespace binlog
+
+/**
+ * Emit the descriptor of this call site into .trace_sites and send a record for it.
+ *
+ * Evaluates to false if the message has to be printed as text instead.
+ */
+#define binlog_print(level, file, fmtstr, ...)                                                        \
+    ({                                                                                                \
+        struct strprov                                                                                \
+        {                                                                                             \
+            static constexpr const char* str()                                                        \
+            {                                                                                         \
+                return fmtstr;                                                                        \
+            }                                                                                         \
+        };                                                                                            \
+        using __binlog_args__ = decltype(pprintpp::tie_types(__VA_ARGS__));                           \
+        using __binlog_format__ = compiled_format::format_string_t<strprov, __binlog_args__>;         \
+        using __binlog_signature__ = decltype(binlog::signature_of(__VA_ARGS__));                     \
+        uintptr_t __binlog_site__;                                                                    \
+        asm(".pushsection .trace_sites, \"a\"\n"                                                      \
+            ".balign 8\n"                                                                             \
+            "1: .quad %c1, %c2, %c3, %c4, %c5\n"                                                      \
+            ".popsection\n"                                                                           \
+            "lea 1b(%%rip), %0"                                                                       \
+            : "=r"(__binlog_site__)                                                                   \
+            : "i"(__binlog_format__::value), "i"(file), "i"(level), "i"(__binlog_signature__::value), \
+              "i"(__LINE__));                                                                         \
+        binlog::emit(__binlog_site__, ##__VA_ARGS__);                                                 \
+    })
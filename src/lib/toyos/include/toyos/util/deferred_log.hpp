@@ -0,0 +1,132 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include <toyos/printf/compiled.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+/**
+ * \brief Log messages that are only printed later.
+ *
+ * deferred_info() does not touch the console. It stores a timestamp, the call site and the raw arguments in a ring
+ * buffer of the current CPU, which makes it usable in measured code and interrupt handlers. The messages are printed
+ * by drain(), which baretest calls at the end of each test case and ASSERT() calls before it stops the test.
+ *
+ * If the ring is full, the oldest messages are overwritten. Strings are stored as pointers, so they have to stay
+ * valid until the messages are printed. String literals are fine.
+ */
+namespace deferred_log
+{
+    static constexpr size_t MAX_ARGS{ 6 };
+
+    /// Messages a CPU keeps before the oldest ones are overwritten.
+    static constexpr size_t CAPACITY{ 256 };
+
+    struct entry;
+
+    /// Prints an entry. There is one per call site, so it also identifies the call site.
+    using print_fn = void (*)(const entry&, uint64_t cycles);
+
+    struct entry
+    {
+        uint64_t tsc{ 0 };
+        print_fn print{ nullptr };
+        uint64_t args[MAX_ARGS]{};
+    };
+
+    /**
+     * Allocate the rings of the first cpus CPUs.
+     *
+     * Rings are otherwise allocated on the first message of a CPU, which may be in a bad place to do so.
+     */
+    void init(size_t cpus);
+
+    /// Store an entry in the ring of the current CPU.
+    void add(const entry& e);
+
+    /// Print and remove all messages of the current CPU.
+    void drain();
+
+    template<typename T>
+    uint64_t pack(const T& value)
+    {
+        static_assert(sizeof(T) <= sizeof(uint64_t) and std::is_trivially_copyable_v<T>,
+                      "Unsupported argument type for deferred logging");
+        uint64_t raw{ 0 };
+        memcpy(&raw, &value, sizeof(T));
+        return raw;
+    }
+
+    template<typename T>
+    T unpack(uint64_t raw)
+    {
+        T value;
+        memcpy(&value, &raw, sizeof(T));
+        return value;
+    }
+
+    /// Type an argument is stored as. Arrays, i.e. string literals, are stored as pointers.
+    template<typename T>
+    using stored_t = std::decay_t<const T&>;
+
+    template<typename STRPROV, typename... ARGS, size_t... I>
+    void replay(const entry& e, uint64_t cycles, std::index_sequence<I...>)
+    {
+        using arg_list = decltype(pprintpp::tie_types(STRPROV::file(), STRPROV::line(), cycles, std::declval<ARGS>()...));
+        compiled_format::print<compiled_format::format_string_t<STRPROV, arg_list>>(STRPROV::file(), STRPROV::line(),
+                                                                                    cycles, unpack<ARGS>(e.args[I])...);
+    }
+
+    template<typename STRPROV, typename... ARGS>
+    void replay(const entry& e, uint64_t cycles)
+    {
+        replay<STRPROV, ARGS...>(e, cycles, std::index_sequence_for<ARGS...>{});
+    }
+
+    template<typename STRPROV, typename... ARGS>
+    void record(const ARGS&... args)
+    {
+        static_assert(sizeof...(ARGS) <= MAX_ARGS, "Too many arguments for deferred logging");
+
+        entry e;
+        e.tsc = rdtsc();
+        e.print = replay<STRPROV, stored_t<ARGS>...>;
+
+        [[maybe_unused]] size_t i{ 0 };
+        ((e.args[i++] = pack<stored_t<ARGS>>(args)), ...);
+
+        add(e);
+    }
+}  // namespace deferred_log
+
+/**
+ * Like info(), but the message is only stored and printed by deferred_log::drain().
+ *
+ * The printed message shows the TSC cycles since the oldest message that was printed with it.
+ */
+#define deferred_info(fmtstr, ...)                      \
+    do {                                                \
+        struct strprov                                  \
+        {                                               \
+            static constexpr const char* str()          \
+            {                                           \
+                return "[DEF {s}:{} +{}] " fmtstr "\n"; \
+            }                                           \
+            static constexpr const char* file()         \
+            {                                           \
+                return strip_file_path(__FILE__);       \
+            }                                           \
+            static constexpr int line()                 \
+            {                                           \
+                return __LINE__;                        \
+            }                                           \
+        };                                              \
+        deferred_log::record<strprov>(__VA_ARGS__);     \
+    } while (0)
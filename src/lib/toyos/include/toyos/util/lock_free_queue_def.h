@@ -75,6 +75,14 @@
 
 #define LFQ_API_VERSION (1)
 
+/**
+ * Version of the multi-producer, multi-consumer variant. It uses the same
+ * layout, but each entry is prefixed by a 64-bit sequence number and
+ * read_position and write_position count up without wrapping around. See
+ * toyos/util/mpmc_queue.hpp.
+ */
+#define LFQ_MPMC_API_VERSION (2)
+
 struct lock_less_queue_meta_t
 {
     uint64_t version;
@@ -0,0 +1,251 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include "lock_free_queue_def.h"
+
+namespace cbl
+{
+
+    /**
+     * A bounded lock free queue for any number of producers and consumers.
+     *
+     * The storage uses the lock_less_queue_t layout with version LFQ_MPMC_API_VERSION, so it can be shared with
+     * other contexts just like the storage of lock_free_queue_base. Each entry carries a sequence number that tells
+     * whether it is free or filled for a certain position:
+     *
+     *  - entry (p % entry_num) is free for position p if its sequence number is p,
+     *  - it is filled for position p if its sequence number is p + 1.
+     *
+     * read_position and write_position are the next positions to claim. A producer or consumer claims positions
+     * with a compare-and-swap on the respective position and then only touches its own entries. Neither side has to
+     * read the position of the other side, so the hot path only shares the entries themselves.
+     *
+     * \tparam T        Type of the stored elements
+     * \tparam MAX_SIZE Maximum length of the queue buffer in number of elements
+     */
+    template<class T, size_t MAX_SIZE>
+    class mpmc_queue
+    {
+     public:
+        static_assert(offsetof(lock_less_queue_t, meta_data) == 0);
+        static_assert(offsetof(lock_less_queue_t, read_position) == 64);
+        static_assert(offsetof(lock_less_queue_t, write_position) == 128);
+
+        struct entry
+        {
+            uint64_t sequence;
+            T element;
+        };
+
+        /**
+         * The storage container for the queue which can check
+         * the whether the underlying has a compatible format.
+         */
+        struct queue_storage : public lock_less_queue_t
+        {
+            alignas(LFQ_CACHE_LINE_SIZE) std::array<entry, MAX_SIZE> entries;
+
+            /** Initializes the queue's meta data and the sequence numbers of all entries
+             * \param num_elems Number of elements that are maximally hold in the
+             *                  queue. Must be lower equal MAX_SIZE. If larger,
+             *                  MAX_SIZE will be used.
+             */
+            void initialize(uint64_t num_elems = MAX_SIZE)
+            {
+                read_position = 0;
+                write_position = 0;
+                meta_data.version = LFQ_MPMC_API_VERSION;
+                meta_data.entry_num = num_elems < MAX_SIZE ? num_elems : MAX_SIZE;
+                meta_data.entry_size = sizeof(entry);
+
+                for (uint64_t i = 0; i < meta_data.entry_num; i++) {
+                    entries[i].sequence = i;
+                }
+            }
+
+            /**
+             * Verifies that the queue storage has a compatible format
+             * \return true if compatible, false otherwise
+             */
+            bool verify() const
+            {
+                return meta_data.version == LFQ_MPMC_API_VERSION and meta_data.entry_size == sizeof(entry) and meta_data.entry_num <= MAX_SIZE;
+            }
+        };
+
+     private:
+        static uint64_t load_acquire(const uint64_t& atom)
+        {
+            return __atomic_load_n(&atom, __ATOMIC_ACQUIRE);
+        }
+
+        static uint64_t load_relaxed(const uint64_t& atom)
+        {
+            return __atomic_load_n(&atom, __ATOMIC_RELAXED);
+        }
+
+        static void store_release(uint64_t& atom, uint64_t val)
+        {
+            __atomic_store_n(&atom, val, __ATOMIC_RELEASE);
+        }
+
+        entry& entry_at(uint64_t position)
+        {
+            return q.entries[position % q.meta_data.entry_num];
+        }
+
+        /// Number of consecutive entries from position on whose sequence number is position + offset, at most max.
+        size_t ready_entries(uint64_t position, uint64_t offset, size_t max)
+        {
+            size_t count{ 0 };
+            while (count < max and load_acquire(entry_at(position + count).sequence) == position + count + offset) {
+                count++;
+            }
+            return count;
+        }
+
+        /**
+         * Claim up to max consecutive positions, starting with the current value of position_ref, whose entries have
+         * a sequence number of position + offset.
+         * \return the first claimed position and the number of claimed positions
+         */
+        std::pair<uint64_t, size_t> claim(uint64_t& position_ref, uint64_t offset, size_t max)
+        {
+            uint64_t position{ load_relaxed(position_ref) };
+
+            while (true) {
+                const size_t count{ ready_entries(position, offset, max) };
+                if (count == 0) {
+                    // The entry is either not ready yet or we raced with another claim and look at a stale position.
+                    const uint64_t current{ load_relaxed(position_ref) };
+                    if (current == position) {
+                        return { position, 0 };
+                    }
+                    position = current;
+                    continue;
+                }
+
+                if (__atomic_compare_exchange_n(&position_ref, &position, position + count, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    return { position, count };
+                }
+            }
+        }
+
+        queue_storage& q;
+
+     public:
+        explicit mpmc_queue(queue_storage& storage)
+            : q(storage) {}
+
+        /**
+         * Creates a new queue from an existing already initialized
+         * storage container.
+         * \param storage storage to be used for the queue
+         * \return a new queue if the storage is compatible, nullptr otherwise
+         */
+        static std::unique_ptr<mpmc_queue> create_from_existing_storage(queue_storage& storage)
+        {
+            if (not storage.verify()) {
+                return nullptr;
+            }
+
+            return std::make_unique<mpmc_queue>(storage);
+        }
+
+        /**
+         *  Returns true iff the queue contained no items at the time of the check.
+         */
+        bool empty()
+        {
+            const uint64_t position{ load_relaxed(q.read_position) };
+            return load_acquire(entry_at(position).sequence) != position + 1;
+        }
+
+        /**
+         *  Adds a new element to the queue.
+         *  \return True iff there was enough space to insert the element.
+         */
+        bool push(const T& elem)
+        {
+            return push(&elem, 1) == 1;
+        }
+
+        /**
+         *  Adds up to count elements to the queue with a single claim.
+         *  \return the number of elements that were inserted, which is lower than count if the queue got full.
+         */
+        size_t push(const T* elems, size_t count)
+        {
+            const auto [first, claimed] = claim(q.write_position, 0, count);
+
+            for (size_t i = 0; i < claimed; i++) {
+                auto& e{ entry_at(first + i) };
+                e.element = elems[i];
+                store_release(e.sequence, first + i + 1);
+            }
+
+            return claimed;
+        }
+
+        /**
+         *  Removes the first element of the queue.
+         *  \return nothing if the queue is empty
+         *  \return the removed element if the queue is non-empty
+         */
+        std::optional<T> pop()
+        {
+            T elem;
+            if (pop(&elem, 1) == 0) {
+                return {};
+            }
+            return elem;
+        }
+
+        /**
+         *  Removes up to max elements from the queue with a single claim.
+         *  \return the number of elements that were written to elems
+         */
+        size_t pop(T* elems, size_t max)
+        {
+            const auto [first, claimed] = claim(q.read_position, 1, max);
+
+            for (size_t i = 0; i < claimed; i++) {
+                auto& e{ entry_at(first + i) };
+                elems[i] = e.element;
+                store_release(e.sequence, first + i + q.meta_data.entry_num);
+            }
+
+            return claimed;
+        }
+    };
+
+    /**
+     * A multi-producer, multi-consumer queue that manages a fixed-size storage
+     * internally. This variant is meant to be used within a single context.
+     * \tparam T        \see mpmc_queue
+     * \tparam MAX_SIZE \see mpmc_queue
+     */
+    template<class T, size_t MAX_SIZE>
+    class static_mpmc_queue : public mpmc_queue<T, MAX_SIZE>
+    {
+     public:
+        static_mpmc_queue()
+            : mpmc_queue<T, MAX_SIZE>(storage)
+        {
+            storage.initialize();
+        }
+
+     private:
+        using storage_t = typename mpmc_queue<T, MAX_SIZE>::queue_storage;
+        storage_t storage;
+    };
+
+}  // namespace cbl
@@ -67,6 +67,12 @@ namespace cbl
             return queue.at(real_idx);
         }
 
+        /// \brief Number of elements in the buffer.
+        size_t size() const
+        {
+            return num_elems;
+        }
+
         /// \brief Reset the buffer to its initial state.
         void flush()
         {
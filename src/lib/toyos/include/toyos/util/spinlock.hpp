@@ -0,0 +1,289 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include <toyos/smp.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+/*
+ * Locks for short critical sections shared between CPUs.
+ *
+ * All locks have lock(), try_lock() and unlock() and a nested guard type that is constructed from a lock, except
+ * mcs_lock, whose waiters need a queue node.
+ */
+
+namespace cbl
+{
+    /// RAII-style lock guard, use the nested guard type of a lock instead.
+    template<typename LOCK>
+    class lock_guard
+    {
+     public:
+        explicit lock_guard(LOCK& lock)
+            : lock_(lock)
+        {
+            lock_.lock();
+        }
+        ~lock_guard()
+        {
+            lock_.unlock();
+        }
+
+        lock_guard(const lock_guard&) = delete;
+        lock_guard& operator=(const lock_guard&) = delete;
+
+     private:
+        LOCK& lock_;
+    };
+}  // namespace cbl
+
+/**
+ * \brief Test-and-set spinlock.
+ *
+ * Waiters spin on a plain load with PAUSE, so the cache line is only written when the lock looks free. The number of
+ * PAUSEs between two loads grows exponentially, which reduces the traffic on the cache line under contention.
+ */
+class spinlock
+{
+    static constexpr unsigned MAX_BACKOFF{ 64 };
+
+ public:
+    using guard = cbl::lock_guard<spinlock>;
+
+    void lock()
+    {
+        unsigned backoff{ 1 };
+
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            while (locked.load(std::memory_order_relaxed)) {
+                for (unsigned i = 0; i < backoff; i++) {
+                    cpu_pause();
+                }
+                backoff = std::min(2 * backoff, MAX_BACKOFF);
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        return not locked.load(std::memory_order_relaxed) and not locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock()
+    {
+        locked.store(false, std::memory_order_release);
+    }
+
+ private:
+    std::atomic<bool> locked{ false };
+};
+
+/**
+ * \brief Ticket lock.
+ *
+ * CPUs get the lock in the order in which they started waiting. Waiters back off in proportion to the number of
+ * CPUs ahead of them.
+ */
+class ticket_lock
+{
+ public:
+    using guard = cbl::lock_guard<ticket_lock>;
+
+    void lock()
+    {
+        const uint32_t ticket{ next.fetch_add(1, std::memory_order_relaxed) };
+
+        while (true) {
+            const uint32_t current{ serving.load(std::memory_order_acquire) };
+            if (current == ticket) {
+                return;
+            }
+
+            for (uint32_t i = 0; i < ticket - current; i++) {
+                cpu_pause();
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        const uint32_t current{ serving.load(std::memory_order_acquire) };
+        uint32_t expected{ current };
+        return next.compare_exchange_strong(expected, current + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+ private:
+    std::atomic<uint32_t> next{ 0 };
+    std::atomic<uint32_t> serving{ 0 };
+};
+
+/**
+ * \brief MCS queue lock.
+ *
+ * Waiters form a queue of nodes and every waiter spins on its own node, so handing over the lock only touches the
+ * cache line of the next waiter. The node passed to lock() has to be passed to unlock() as well.
+ */
+class mcs_lock
+{
+ public:
+    struct alignas(CPU_CACHE_LINE_SIZE) node
+    {
+        std::atomic<node*> next{ nullptr };
+        std::atomic<bool> waiting{ false };
+    };
+
+    void lock(node& me)
+    {
+        me.next.store(nullptr, std::memory_order_relaxed);
+        me.waiting.store(true, std::memory_order_relaxed);
+
+        node* predecessor{ tail.exchange(&me, std::memory_order_acq_rel) };
+        if (predecessor == nullptr) {
+            return;
+        }
+
+        predecessor->next.store(&me, std::memory_order_release);
+        while (me.waiting.load(std::memory_order_acquire)) {
+            cpu_pause();
+        }
+    }
+
+    bool try_lock(node& me)
+    {
+        me.next.store(nullptr, std::memory_order_relaxed);
+
+        node* expected{ nullptr };
+        return tail.compare_exchange_strong(expected, &me, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock(node& me)
+    {
+        node* successor{ me.next.load(std::memory_order_acquire) };
+
+        if (successor == nullptr) {
+            node* expected{ &me };
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+
+            // A waiter already swapped itself into the tail, but did not link itself to us yet.
+            while ((successor = me.next.load(std::memory_order_acquire)) == nullptr) {
+                cpu_pause();
+            }
+        }
+
+        successor->waiting.store(false, std::memory_order_release);
+    }
+
+    /// RAII-style lock guard that brings its own queue node.
+    class guard
+    {
+     public:
+        explicit guard(mcs_lock& lock)
+            : lock_(lock)
+        {
+            lock_.lock(node_);
+        }
+        ~guard()
+        {
+            lock_.unlock(node_);
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+     private:
+        mcs_lock& lock_;
+        node node_;
+    };
+
+ private:
+    std::atomic<node*> tail{ nullptr };
+};
+
+/**
+ * \brief Test-and-set spinlock that stops spinning after a while.
+ *
+ * In a VM, the lock holder may be preempted by the host. Waiters then burn the time slices of their vCPUs without
+ * any chance to get the lock. After spinning for the given budget, a waiter of this lock halts instead, which gives
+ * the physical CPU back to the host. The lock holder kicks a halted waiter when it releases the lock.
+ *
+ * The library does not own an interrupt vector, so kicking is done by a function provided by the user, usually by
+ * sending an IPI to the given CPU. The interrupt only needs to be acknowledged. lock() must be called with interrupts
+ * disabled, so a kick between registering as halted waiter and HLT is not lost.
+ */
+class pv_spinlock
+{
+ public:
+    using guard = cbl::lock_guard<pv_spinlock>;
+    using kick_fn = void (*)(size_t cpu);
+
+    static constexpr unsigned DEFAULT_SPIN_BUDGET{ 1024 };
+
+    static_assert(smp::MAX_CPUS <= 64, "Halted waiters are tracked in a 64-bit mask");
+
+    explicit pv_spinlock(kick_fn kick, unsigned spin_budget = DEFAULT_SPIN_BUDGET)
+        : kick_(kick), spin_budget_(spin_budget) {}
+
+    void lock()
+    {
+        while (true) {
+            for (unsigned i = 0; i < spin_budget_; i++) {
+                if (try_lock()) {
+                    return;
+                }
+                cpu_pause();
+            }
+
+            const uint64_t me{ uint64_t(1) << smp::current_cpu() };
+            halted_waiters.fetch_or(me);
+
+            // The lock may have been released before the holder saw us.
+            const bool acquired{ try_lock() };
+            if (not acquired) {
+                enable_interrupts_and_halt();
+                disable_interrupts();
+            }
+
+            halted_waiters.fetch_and(~me);
+
+            if (acquired) {
+                return;
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        return not locked.load(std::memory_order_relaxed) and not locked.exchange(true, std::memory_order_seq_cst);
+    }
+
+    void unlock()
+    {
+        locked.store(false, std::memory_order_seq_cst);
+
+        const uint64_t waiters{ halted_waiters.load() };
+        if (waiters != 0) {
+            kick_(static_cast<size_t>(__builtin_ctzll(waiters)));
+        }
+    }
+
+ private:
+    std::atomic<bool> locked{ false };
+    std::atomic<uint64_t> halted_waiters{ 0 };
+
+    kick_fn kick_;
+    unsigned spin_budget_;
+};
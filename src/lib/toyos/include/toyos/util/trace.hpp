@@ -6,10 +6,22 @@
 #ifndef HOSTED
 // not part of standard libc
 #include <compiler.h>
+#include <toyos/printf/compiled.hpp>
+#include <toyos/util/binlog.hpp>
 #endif
 #include <cstdint>
 #include <pprintpp/pprintpp.hpp>
 #include <stdio.h>
+#include <string_view>
+
+#ifndef HOSTED
+// ASSERT() only needs drain(). toyos/util/deferred_log.hpp includes toyos/x86/x86asm.hpp, which includes assert.h and
+// thus this header again.
+namespace deferred_log
+{
+    void drain();
+}  // namespace deferred_log
+#endif
 
 enum : uint64_t
 {
@@ -38,6 +50,68 @@ enum : uint64_t
                  | TRACE_QUIRK | TRACE_HOTPLUG | TRACE_SRIOV
 };
 
+/// Categories that trace() prints. Starts out as TRACE_MASK, the trace cmdline modifier changes it at boot.
+inline uint64_t trace_mask{ TRACE_MASK };
+
+struct trace_category
+{
+    const char* name;  ///< Name as used by the trace cmdline modifier.
+    uint64_t mask;
+};
+
+inline constexpr trace_category TRACE_CATEGORIES[]{
+    { "verbose", TRACE_VERBOSE },
+    { "buddy", TRACE_BUDDY },
+    { "boot", TRACE_BOOT },
+    { "memmap", TRACE_MEMMAP },
+    { "thread", TRACE_THREAD },
+    { "gsi", TRACE_GSI },
+    { "loader", TRACE_LOADER },
+    { "msr", TRACE_MSR },
+    { "bios", TRACE_BIOS },
+    { "mmu", TRACE_MMU },
+    { "lapic", TRACE_LAPIC },
+    { "ioapic", TRACE_IOAPIC },
+    { "pic", TRACE_PIC },
+    { "pci", TRACE_PCI },
+    { "hpet", TRACE_HPET },
+    { "xhci", TRACE_XHCI },
+    { "quirk", TRACE_QUIRK },
+    { "roottask", TRACE_ROOTTASK },
+    { "hotplug", TRACE_HOTPLUG },
+    { "sriov", TRACE_SRIOV },
+};
+
+/// Mask of the trace category with the given name, all categories for "all", or 0 for unknown names.
+inline constexpr uint64_t trace_category_mask(std::string_view name)
+{
+    uint64_t all{ 0 };
+    for (const auto& category : TRACE_CATEGORIES) {
+        if (name == category.name) {
+            return category.mask;
+        }
+        all |= category.mask;
+    }
+    return name == "all" ? all : 0;
+}
+
+/**
+ * Add the trace category with the given name to the mask, or remove it if the name starts with '-'.
+ *
+ * \return false for unknown names, which leave the mask unchanged.
+ */
+inline constexpr bool apply_trace_category(uint64_t& mask, std::string_view name)
+{
+    const bool remove{ not name.empty() and name.front() == '-' };
+    const uint64_t category{ trace_category_mask(remove ? name.substr(1) : name) };
+    if (category == 0) {
+        return false;
+    }
+
+    mask = remove ? mask & ~category : mask | category;
+    return true;
+}
+
 /// Strip all directories from a file path.
 ///
 /// Example: strip_file_path("../foo/bar.cpp") -> "bar.cpp"
@@ -56,18 +130,30 @@ inline constexpr const char* strip_file_path(const char* file_name)
     return shortened_name;
 }
 
+#ifdef HOSTED
 #define print_macro(level, fmtstr, ...)                                                       \
     do {                                                                                      \
         constexpr const char* __short_path__{ strip_file_path(__FILE__) };                    \
         pprintf("[" #level " {s}:{}] " fmtstr "\n", __short_path__, __LINE__, ##__VA_ARGS__); \
     } while (0);
+#else
+// With binary logging, the message is only formatted on the host. See toyos/util/binlog.hpp.
+#define print_macro(level, fmtstr, ...)                                                                    \
+    do {                                                                                                   \
+        constexpr const char* __short_path__{ strip_file_path(__FILE__) };                                 \
+        if (not binlog::enabled or not binlog_print(#level, __short_path__, fmtstr, ##__VA_ARGS__)) {      \
+            pprintf_compiled("[" #level " {s}:{}] " fmtstr "\n", __short_path__, __LINE__, ##__VA_ARGS__); \
+        }                                                                                                  \
+    } while (0);
+#endif
 
 #define info(fmtstr, ...) print_macro(INF, fmtstr, ##__VA_ARGS__)
 #define warning(fmtstr, ...) print_macro(WRN, fmtstr, ##__VA_ARGS__)
 
+// Disabled categories only cost a load of trace_mask and a branch.
 #define trace(context, fmtstr, ...)                  \
     do {                                             \
-        if ((TRACE_MASK & (context)) == (context)) { \
+        if ((trace_mask & (context)) == (context)) { \
             info(fmtstr, ##__VA_ARGS__);             \
         }                                            \
     } while (0);
@@ -88,13 +174,14 @@ inline constexpr const char* strip_file_path(const char* file_name)
         }                                                            \
     } while (0);
 #else
-#define ASSERT(cond, fmtstr, ...)                                     \
-    do {                                                              \
-        if (UNLIKELY(!(cond))) {                                      \
-            pprintf("[%s:%d]  ", __FILE__, __LINE__);                 \
-            pprintf("Assertion failed: " fmtstr "\n", ##__VA_ARGS__); \
-            INTERNAL_TRAP();                                          \
-        }                                                             \
+#define ASSERT(cond, fmtstr, ...)                                              \
+    do {                                                                       \
+        if (UNLIKELY(!(cond))) {                                               \
+            pprintf_compiled("[%s:%d]  ", __FILE__, __LINE__);                 \
+            pprintf_compiled("Assertion failed: " fmtstr "\n", ##__VA_ARGS__); \
+            deferred_log::drain();                                             \
+            INTERNAL_TRAP();                                                   \
+        }                                                                      \
     } while (0);
 #endif
 
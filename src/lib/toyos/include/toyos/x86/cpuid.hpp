@@ -7,10 +7,18 @@ enum
 {
     CPUID_LEAF_MAX_LEVEL_VENDOR_ID = 0x00000000,
     CPUID_LEAF_FAMILY_FEATURES = 0x00000001,
+    CPUID_LEAF_CACHE_PARAMETERS = 0x00000004,
     CPUID_LEAF_POWER_MANAGEMENT = 0x00000006,
     CPUID_LEAF_EXTENDED_FEATURES = 0x00000007,
+    CPUID_LEAF_EXTENDED_TOPOLOGY = 0x0000000B,
     CPUID_LEAF_EXTENDED_STATE = 0x0000000D,
     CPUID_LEAF_SGX_CAPABILITY = 0x00000012,
+    CPUID_LEAF_V2_EXTENDED_TOPOLOGY = 0x0000001F,
+    /// Maximum hypervisor leaf and hypervisor vendor ID. Only meaningful if CPUID.1:ECX.HV is set.
+    CPUID_LEAF_HYPERVISOR_BASE = 0x40000000,
+    /// Maximum extended leaf.
+    CPUID_LEAF_EXTENDED_MAX_LEVEL = 0x80000000,
+    CPUID_LEAF_EXTENDED_PROCESSOR_INFO = 0x80000001,
     /**
      * Base leaf for the extended CPU brand string. The full name is in this
      * leaf and the two subsequent leaves.
@@ -46,6 +46,15 @@ inline void outb(uint16_t port, uint8_t value)
     asm volatile("outb %%al, %%dx" ::"d"(port), "a"(value));
 }
 
+/// Write count bytes to the given port with a single string instruction.
+inline void outsb(uint16_t port, const void* data, size_t count)
+{
+    asm volatile("rep outsb"
+                 : "+S"(data), "+c"(count)
+                 : "d"(port)
+                 : "memory");
+}
+
 inline uint16_t inw(uint16_t port)
 {
     unsigned value;
@@ -86,6 +95,15 @@ inline uint32_t get_tsc_aux()
     return tsc_aux;
 }
 
+/// Read IA32_TSC_AUX without reading the time stamp counter. Requires RDPID support.
+inline uint64_t rdpid()
+{
+    uint64_t tsc_aux;
+    asm volatile("rdpid %0"
+                 : "=r"(tsc_aux));
+    return tsc_aux;
+}
+
 inline void cpu_pause()
 {
     asm volatile("pause");
@@ -126,6 +144,12 @@ inline x86::descriptor_ptr get_current_gdtr()
     return ret;
 }
 
+inline void set_current_gdtr(const x86::descriptor_ptr& gdtr)
+{
+    asm volatile("lgdt %0" ::"m"(gdtr)
+                 : "memory");
+}
+
 inline x86::descriptor_ptr get_current_idtr()
 {
     x86::descriptor_ptr ret;
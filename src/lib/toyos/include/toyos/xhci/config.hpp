@@ -38,8 +38,9 @@ static constexpr size_t MAX_PACKET_SIZE{ 1024 };
 // Each transfer request can hold up to this many bytes.
 // For input, we don't expect large requests, so 1 KiB should be enough.
 static constexpr size_t IN_BUF_SIZE{ MAX_PACKET_SIZE };
-// For output, we want to transfer as much as possible.
-static constexpr size_t OUT_BUF_SIZE{ 64 * 1024 };
+// For output, we want to transfer as much as possible, but also have several
+// transfers in flight.
+static constexpr size_t OUT_BUF_SIZE{ 32 * 1024 };
 // Note that the maximum is actually 64 KiB - 1, because the length
 // field is only 16 bits.
 static constexpr size_t TRANSFER_MAX{ 64 * 1024 - 1 };
@@ -47,10 +48,10 @@ static constexpr size_t TRANSFER_MAX{ 64 * 1024 - 1 };
 // Requests (or events) are managed in ring buffers with this many entries.
 static constexpr size_t EVENT_RING_SIZE{ 16 };
 static constexpr size_t IN_RING_SIZE{ 16 };
-// Currently, scheduling multiple transfers at a time hangs
-// the controller. We don't need a large ring because
-// we always wait for the previous transfer to be completed.
-static constexpr size_t OUT_RING_SIZE{ 4 };
+// Output transfers are pipelined, so the output ring determines how many
+// transfers can be in flight. One entry is the Link TRB and one is needed to
+// tell a full from an empty ring.
+static constexpr size_t OUT_RING_SIZE{ 8 };
 
 // All rings and transfer buffers need to be accessible via DMA.
 // These constants provide shortcuts to size calculations when
@@ -30,9 +30,11 @@ class xhci_console_base : public console
      * \param identifier  The value to be used in SerialNumber.
      * \param mmio_region The MMIO BAR containing the xHC register set.
      * \param dma_region  The DMA region to be used as allocation pool.
+     * \param mode        Whether output transfers are pipelined.
      */
-    xhci_console_base(std::unique_ptr<device_driver_adapter> adapter, const std::u16string& identifier, const cbl::interval& mmio_region, xhci_debug_device::power_cycle_method power_method)
-        : adapter_(std::move(adapter)), dbc_dev_(MANUFACTURER_STR, DEVICE_STR, identifier, *adapter_, phy_addr_t(mmio_region.a), power_method)
+    xhci_console_base(std::unique_ptr<device_driver_adapter> adapter, const std::u16string& identifier, const cbl::interval& mmio_region, xhci_debug_device::power_cycle_method power_method,
+                      xhci_debug_device::transfer_mode mode = xhci_debug_device::transfer_mode::PIPELINED)
+        : adapter_(std::move(adapter)), dbc_dev_(MANUFACTURER_STR, DEVICE_STR, identifier, *adapter_, phy_addr_t(mmio_region.a), power_method, mode)
     {
         dbc_dev_.initialize();
     }
@@ -41,7 +43,11 @@ class xhci_console_base : public console
 
     virtual void putc(char c) override;
 
+    /// Transfers the characters at once, unless they exceed the output buffer.
+    virtual void write(const char* data, size_t size) override;
+
     static void putchar(unsigned char c);
+    static void putstr(const char* data, size_t size);
 
     /**
      * Do queue maintenance and re-connect if the connection was lost.
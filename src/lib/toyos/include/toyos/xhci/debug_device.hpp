@@ -33,10 +33,17 @@ class xhci_debug_device : public xhci_device
         POWERCYCLE,
     };
 
+    /// How many output transfers may be in flight at once.
+    enum class transfer_mode
+    {
+        PIPELINED,           ///< as many as the output ring can hold
+        SINGLE_OUTSTANDING,  ///< one, for debug devices that hang with several outstanding transfers
+    };
+
     using dbc_capability = xhci_dbc_capability;
 
-    xhci_debug_device(const std::u16string& manuf, const std::u16string& product, const std::u16string& serial, device_driver_adapter& adapter, phy_addr_t mmio_base, power_cycle_method power_method)
-        : xhci_device(adapter, mmio_base), manuf_(manuf), product_(product), serial_(serial), debug_structs_(adapter.allocate_pages(1)), event_ring_buffer_(adapter.allocate_pages(EVENT_RING_PAGES)), out_ring_buffer_(adapter.allocate_pages(OUT_RING_PAGES)), in_ring_buffer_(adapter.allocate_pages(IN_RING_PAGES)), in_data_buffer_(adapter.allocate_pages(IN_BUF_PAGES)), out_data_buffer_(adapter.allocate_pages(OUT_BUF_PAGES)), poll_mtx_(adapter.get_mutex()), init_mtx_(adapter.get_mutex()), power_method_(power_method)
+    xhci_debug_device(const std::u16string& manuf, const std::u16string& product, const std::u16string& serial, device_driver_adapter& adapter, phy_addr_t mmio_base, power_cycle_method power_method, transfer_mode mode = transfer_mode::PIPELINED)
+        : xhci_device(adapter, mmio_base), manuf_(manuf), product_(product), serial_(serial), debug_structs_(adapter.allocate_pages(1)), event_ring_buffer_(adapter.allocate_pages(EVENT_RING_PAGES)), out_ring_buffer_(adapter.allocate_pages(OUT_RING_PAGES)), in_ring_buffer_(adapter.allocate_pages(IN_RING_PAGES)), in_data_buffer_(adapter.allocate_pages(IN_BUF_PAGES)), out_data_buffer_(adapter.allocate_pages(OUT_BUF_PAGES)), poll_mtx_(adapter.get_mutex()), init_mtx_(adapter.get_mutex()), power_method_(power_method), transfer_mode_(mode)
     {
         setup_info_context();
     }
@@ -143,4 +150,5 @@ class xhci_debug_device : public xhci_device
     std::unique_ptr<mutex> init_mtx_;
 
     power_cycle_method power_method_;
+    transfer_mode transfer_mode_;
 };
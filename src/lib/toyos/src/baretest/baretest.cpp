@@ -6,7 +6,14 @@
 #include <toyos/boot.hpp>
 #include <toyos/boot_cmdline.hpp>
 #include <toyos/cmdline.hpp>
+#include <toyos/printf/backend.hpp>
+#include <toyos/printf/xprintf.h>
+#include <toyos/smp.hpp>
 #include <toyos/util/cpuid.hpp>
+#include <toyos/util/deferred_log.hpp>
+
+#include <array>
+#include <functional>
 
 void __attribute__((weak)) prologue()
 {}
@@ -34,10 +41,75 @@ void print_environment_info()
 namespace baretest
 {
 
+    namespace
+    {
+        /// Maximum output of a single test case running on an AP.
+        constexpr size_t OUTPUT_BUFFER_SIZE{ 8192 };
+
+        /**
+         * A test case running on an AP and its buffered output.
+         *
+         * Only the BSP hands out and reaps slots, so apart from the synchronization done by smp::start_on() and
+         * smp::wait_for() no locking is needed.
+         */
+        struct alignas(CPU_CACHE_LINE_SIZE) ap_slot
+        {
+            const test_case* tc{ nullptr };
+            test_case::result_t result{ test_case::result_t::SKIPPED };
+            bool busy{ false };
+
+            size_t output_size{ 0 };
+            bool output_truncated{ false };
+            std::array<char, OUTPUT_BUFFER_SIZE> output;
+
+            std::function<void()> work;
+        };
+
+        ap_slot ap_slots[smp::MAX_CPUS];
+
+        /// Output function while test cases run in parallel. Output of APs is buffered until their test case is reported.
+        void buffered_output(unsigned char c)
+        {
+            const size_t cpu{ smp::current_cpu() };
+            if (cpu == 0) {
+                print_to_all_backends(c);
+                return;
+            }
+
+            auto& slot{ ap_slots[cpu] };
+            if (slot.output_size < slot.output.size()) {
+                slot.output[slot.output_size++] = static_cast<char>(c);
+            }
+            else {
+                slot.output_truncated = true;
+            }
+        }
+
+        void flush_output(ap_slot& slot)
+        {
+            for (size_t i = 0; i < slot.output_size; i++) {
+                print_to_all_backends(static_cast<unsigned char>(slot.output[i]));
+            }
+            if (slot.output_truncated) {
+                printf("- output truncated to %u bytes\n", static_cast<unsigned>(slot.output.size()));
+            }
+
+            slot.output_size = 0;
+            slot.output_truncated = false;
+        }
+
+        bool parallel_tests_enabled()
+        {
+            auto parser{ cmdline::cmdline_parser(get_boot_cmdline().value_or("")) };
+            return parser.parallel_tests_option().has_value();
+        }
+    }  // namespace
+
     jmp_buf& get_env()
     {
-        static jmp_buf env;
-        return env;
+        // Test cases on different CPUs fail independently.
+        static jmp_buf envs[smp::MAX_CPUS];
+        return envs[smp::current_cpu()];
     }
 
     test_suite& get_suite()
@@ -48,7 +120,13 @@ namespace baretest
 
     bool test_case::run() const
     {
-        result_t res = fn_();
+        const result_t res{ fn_() };
+        deferred_log::drain();
+        return report(res);
+    }
+
+    bool test_case::report(result_t res) const
+    {
         switch (res) {
             case result_t::SUCCESS:
                 success(name);
@@ -64,21 +142,99 @@ namespace baretest
         }
     }
 
-    test_case::test_case(test_suite& suite, const char* name_, test_case_fn tc)
-        : name(name_), fn_(tc)
+    test_case::test_case(test_suite& suite, const char* name_, test_case_fn tc, bool serial_)
+        : name(name_), fn_(tc), serial(serial_)
     {
         suite.add(*this);
     }
 
     void test_suite::run()
     {
+        const bool parallel{ parallel_tests_enabled() };
+        if (parallel) {
+            smp::init();
+        }
+
+        // Test cases should not pay for the allocation of the rings with their first deferred message.
+        deferred_log::init(smp::cpu_count());
+
         hello(test_cases.size());
-        for (const auto& tc : test_cases) {
-            tc.run();
+        if (parallel and smp::cpu_count() > 1) {
+            run_parallel();
+        }
+        else {
+            for (const auto& tc : test_cases) {
+                tc.run();
+            }
         }
         goodbye();
     }
 
+    void test_suite::run_parallel()
+    {
+        const size_t count{ test_cases.size() };
+
+        // CPU that runs a test case, valid once it was dispatched.
+        std::vector<size_t> cpu_of(count, 0);
+
+        for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+            auto& slot{ ap_slots[cpu] };
+            slot.work = [&slot] {
+                slot.result = slot.tc->fn_();
+                deferred_log::drain();
+            };
+        }
+
+        auto find_idle_ap{ [] {
+            for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+                if (not ap_slots[cpu].busy) {
+                    return cpu;
+                }
+            }
+            return size_t(0);
+        } };
+
+        size_t next_dispatch{ 0 };
+        for (size_t next_report = 0; next_report < count; next_report++) {
+            // Hand out test cases in order, but never overtake a serial test case.
+            while (next_dispatch < count and not test_cases[next_dispatch].serial) {
+                const size_t cpu{ find_idle_ap() };
+                if (cpu == 0) {
+                    break;
+                }
+
+                auto& slot{ ap_slots[cpu] };
+                slot.tc = &test_cases[next_dispatch];
+                slot.busy = true;
+                cpu_of[next_dispatch++] = cpu;
+
+                xdev_out(buffered_output);
+                xdev_out_bulk(nullptr);
+                smp::start_on(cpu, slot.work);
+            }
+
+            const auto& tc{ test_cases[next_report] };
+
+            if (tc.serial) {
+                // All previous test cases are reported, so nothing else is running.
+                xdev_out(print_to_all_backends);
+                xdev_out_bulk(print_string_to_all_backends);
+                tc.run();
+                next_dispatch++;
+                continue;
+            }
+
+            auto& slot{ ap_slots[cpu_of[next_report]] };
+            smp::wait_for(cpu_of[next_report]);
+            flush_output(slot);
+            tc.report(slot.result);
+            slot.busy = false;
+        }
+
+        xdev_out(print_to_all_backends);
+        xdev_out_bulk(print_string_to_all_backends);
+    }
+
     __attribute__((noreturn)) void fail(const char* msg, ...)
     {
         va_list args;
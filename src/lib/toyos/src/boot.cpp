@@ -17,16 +17,21 @@
 #include <toyos/console/console_debugcon.hpp>
 #include <toyos/console/console_serial.hpp>
 #include <toyos/console/console_serial_util.hpp>
+#include <toyos/console/console_shmem.hpp>
+#include <toyos/console/console_virtio.hpp>
 #include <toyos/console/xhci_console.hpp>
 #include <toyos/memory/buddy.hpp>
 #include <toyos/memory/simple_buddy.hpp>
 #include <toyos/multiboot/multiboot.hpp>
 #include <toyos/multiboot2/multiboot2.hpp>
 #include <toyos/pci/bus.hpp>
+#include <toyos/per_cpu.hpp>
+#include <toyos/printf/backend.hpp>
 #include <toyos/testhelper/lapic_test_tools.hpp>
 #include <toyos/testhelper/pic.hpp>
 #include <toyos/util/cpuid.hpp>
 #include <toyos/util/interval.hpp>
+#include <toyos/util/spinlock.hpp>
 #include <toyos/x86/arch.hpp>
 #include <toyos/x86/segmentation.hpp>
 #include <toyos/xen-pvh.hpp>
@@ -42,6 +47,10 @@ extern uint64_t gdt_tss;
 first_fit_heap<HEAP_ALIGNMENT>* current_heap{ nullptr };
 simple_buddy* aligned_heap{ nullptr };
 
+// Protects both global heaps against concurrent use from several CPUs.
+// Most allocations on APs are served by their per-CPU arenas instead, see smp::arena_alloc().
+static spinlock heap_lock;
+
 static constexpr size_t DMA_POOL_SIZE{ 0x100000 };
 alignas(PAGE_SIZE) static char dma_pool_data[DMA_POOL_SIZE];
 alignas(PAGE_SIZE) static x86::tss tss;  // alignment only used to avoid crossing page boundaries
@@ -81,12 +90,7 @@ EXTERN_C void init_heap()
     aligned_heap = &align_buddy;
 }
 
-/**
- * \brief Set up a 64 bit TSS.
- *
- * After activating IA-32e mode, we have to create a 64 bit TSS (Intel SDM, Vol. 3, 7.7).
- */
-EXTERN_C void init_tss()
+void load_tss(x86::tss& cpu_tss)
 {
     static const uint16_t TSS_GDT_INDEX{ static_cast<uint16_t>(&gdt_tss - &gdt_start) };
     x86::segment_selector tss_selector{ static_cast<uint16_t>(TSS_GDT_INDEX << x86::segment_selector::INDEX_SHIFT) };
@@ -94,7 +98,7 @@ EXTERN_C void init_tss()
 
     gdte->set_system(true);  // TSS descriptor is a system descriptor
     gdte->set_g(false);      // interpret limit as bytes
-    gdte->set_base(ptr_to_num(&tss));
+    gdte->set_base(ptr_to_num(&cpu_tss));
     gdte->set_limit(sizeof(x86::tss));
     gdte->set_present(true);
     gdte->set_type(x86::gdt_entry::segment_type::TSS_64BIT_AVAIL);
@@ -102,6 +106,16 @@ EXTERN_C void init_tss()
     asm volatile("ltr %0" ::"r"(tss_selector.value()));
 }
 
+/**
+ * \brief Set up a 64 bit TSS.
+ *
+ * After activating IA-32e mode, we have to create a 64 bit TSS (Intel SDM, Vol. 3, 7.7).
+ */
+EXTERN_C void init_tss()
+{
+    load_tss(tss);
+}
+
 static std::u16string get_xhci_identifier(const std::string& arg)
 {
     std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
@@ -118,12 +132,31 @@ std::optional<std::string> get_boot_cmdline()
     return boot_cmdline;
 }
 
+/**
+ * The RSDP handed over by the boot loader. Null if it has to be searched for.
+ */
+static const acpi_rsdp* boot_rsdp{ nullptr };
+const acpi_rsdp* get_boot_rsdp()
+{
+    return boot_rsdp;
+}
+
 static void initialize_console(const std::string& cmdline, acpi_mcfg* mcfg)
 {
     cmdline::cmdline_parser p(cmdline);
 
     auto serial_option = p.serial_option();
     auto xhci_option = p.xhci_option();
+    auto virtio_console_option = p.virtio_console_option();
+    auto shmem_log_option = p.shmem_log_option();
+
+    if (p.debugcon_byte_io_option()) {
+        debugcon::use_string_io = false;
+    }
+
+    if (p.binary_log_option()) {
+        binlog::enabled = true;
+    }
 
     if (serial_option.has_value()) {
         uint16_t port = get_effective_serial_port(serial_option.value(), mcfg);
@@ -156,10 +189,62 @@ static void initialize_console(const std::string& cmdline, acpi_mcfg* mcfg)
             }
 
             auto power_method = p.xhci_power_option() == "1" ? xhci_debug_device::power_cycle_method::POWERCYCLE : xhci_debug_device::power_cycle_method::NONE;
-            static xhci_console_baremetal xhci_cons(get_xhci_identifier(*xhci_option), mmio_region, dma_region, power_method);
+            auto transfer_mode = p.xhci_single_transfer_option() ? xhci_debug_device::transfer_mode::SINGLE_OUTSTANDING : xhci_debug_device::transfer_mode::PIPELINED;
+            static xhci_console_baremetal xhci_cons(get_xhci_identifier(*xhci_option), mmio_region, dma_region, power_method, transfer_mode);
             xhci_console_init(xhci_cons);
         }
     }
+    else if (virtio_console_option) {
+        PANIC_UNLESS(mcfg, "No valid MCFG pointer given!");
+
+        pci_bus pcibus(phy_addr_t(mcfg->base), mcfg->busses());
+
+        auto is_virtio_console_fn = [](const pci_device& dev) {
+            return dev.vendor_id() == virtio::PCI_VENDOR_ID and dev.device_id() == virtio::PCI_DEVICE_ID_CONSOLE;
+        };
+        auto virtio_pci_dev = std::find_if(pcibus.begin(), pcibus.end(), is_virtio_console_fn);
+
+        bool initialized{ false };
+        if (virtio_pci_dev != pcibus.end()) {
+            auto dma_region = pn2addr(allocate_dma_mem(math::order_envelope(console_virtio::DMA_PAGES)));
+            initialized = virtio_console_init(*virtio_pci_dev, dma_region);
+        }
+
+        if (not initialized) {
+            serial_init(discover_serial_port(mcfg));
+            info("No usable virtio console found, using serial port instead");
+        }
+    }
+    else if (shmem_log_option) {
+        std::optional<cbl::interval> region;
+        if (shmem_log_option->empty()) {
+            PANIC_UNLESS(mcfg, "No valid MCFG pointer given!");
+
+            pci_bus pcibus(phy_addr_t(mcfg->base), mcfg->busses());
+
+            auto is_ivshmem_fn = [](const pci_device& dev) {
+                return dev.vendor_id() == shmem::IVSHMEM_VENDOR_ID and dev.device_id() == shmem::IVSHMEM_DEVICE_ID;
+            };
+            auto ivshmem_pci_dev = std::find_if(pcibus.begin(), pcibus.end(), is_ivshmem_fn);
+
+            if (ivshmem_pci_dev != pcibus.end()) {
+                const auto& pci_dev(*ivshmem_pci_dev);
+                auto* bar = pci_dev.bar(shmem::IVSHMEM_SHARED_MEMORY_BAR);
+                if (bar->is_mem()) {
+                    region = cbl::interval::from_size(bar->address(), bar->bar_size());
+                    pci_dev.enable_memory_and_bus_master();
+                }
+            }
+        }
+        else {
+            region = shmem::parse_region(*shmem_log_option);
+        }
+
+        if (not region or not shmem_console_init(*region)) {
+            serial_init(discover_serial_port(mcfg));
+            info("No usable shared memory for logging found, using serial port instead");
+        }
+    }
     else {
         serial_init(discover_serial_port(mcfg));
     }
@@ -169,6 +254,20 @@ static void initialize_console(const std::string& cmdline, acpi_mcfg* mcfg)
     printf("\n\n");
 }
 
+/// Returns the names that are no trace category. They can only be reported once the console is up.
+static std::vector<std::string> initialize_trace_mask(const std::string& cmdline)
+{
+    cmdline::cmdline_parser p(cmdline);
+    std::vector<std::string> unknown;
+
+    for (const auto& name : p.trace_option()) {
+        if (not apply_trace_category(trace_mask, name)) {
+            unknown.push_back(name);
+        }
+    }
+    return unknown;
+}
+
 static void initialize_dma_pool()
 {
     memset(dma_pool_data, 0, DMA_POOL_SIZE);
@@ -194,6 +293,8 @@ void __attribute__((noreturn)) shutdown()
     constexpr uint16_t VIRTUALBOX_SHUTDOWN_PORT = 0x4004;
     constexpr uint16_t VIRTUALBOX_SHUTDOWN_VALUE = 0x3400;
 
+    flush_printf_backends();
+
     if (util::cpuid::hv_bit_present()) {
         // Order is not important.
         // Unknown PIO writes are ignored by VMMs in general.
@@ -248,6 +349,7 @@ EXTERN_C void entry64(uint32_t magic, uintptr_t boot_info)
 
         const auto rsdp{ reinterpret_cast<const acpi_rsdp*>(info->rsdp_paddr) };
         mcfg = find_mcfg(rsdp);
+        boot_rsdp = rsdp;
     }
     else if (magic == multiboot::multiboot_module::MAGIC_LDR) {
         current_boot_method = boot_method::MULTIBOOT1;
@@ -282,6 +384,7 @@ EXTERN_C void entry64(uint32_t magic, uintptr_t boot_info)
             const auto acpi_full_tag{ acpi_tag->get_full_tag<multiboot2::mbi2_rsdp2>() };
             const auto rsdp{ reinterpret_cast<const acpi_rsdp*>(acpi_tag->addr + sizeof(acpi_full_tag)) };
             mcfg = find_mcfg(rsdp);
+            boot_rsdp = rsdp;
         }
     }
     else {
@@ -289,7 +392,13 @@ EXTERN_C void entry64(uint32_t magic, uintptr_t boot_info)
     }
 
     boot_cmdline = cmdline;
+
+    // The console drivers already trace while they come up.
+    const auto unknown_trace_categories{ initialize_trace_mask(cmdline) };
     initialize_console(cmdline, mcfg);
+    for (const auto& name : unknown_trace_categories) {
+        warning("Unknown trace category: {s}", name.c_str());
+    }
 
     main();
 
@@ -298,7 +407,13 @@ EXTERN_C void entry64(uint32_t magic, uintptr_t boot_info)
 
 void* operator new(size_t size)
 {
+    if (auto p{ smp::arena_alloc(size) }) {
+        return p;
+    }
+
     ASSERT(current_heap, "heap not initialized");
+    smp::this_cpu().stats.heap_allocations++;
+    spinlock::guard _{ heap_lock };
     auto tmp{ current_heap->alloc(size) };
     ASSERT(tmp, "out of memory");
     return tmp;
@@ -309,9 +424,11 @@ void* operator new(size_t size, std::align_val_t alignment)  // C++17, nodiscard
     // use default heap if possible
     ASSERT(current_heap, "heap not initialized");
     if (alignment <= static_cast<std::align_val_t>(current_heap->alignment())) {
-        return current_heap->alloc(size);
+        return operator new(size);
     }
 
+    spinlock::guard _{ heap_lock };
+
     ASSERT(aligned_heap, "aligned heap not initialized");
 
     if (math::order_max(static_cast<size_t>(alignment)) > aligned_heap->max_order) {
@@ -357,7 +474,12 @@ void* operator new[](size_t size, std::align_val_t alignment,
 
 void operator delete(void* p) noexcept
 {
+    if (smp::arena_free(p)) {
+        return;
+    }
+
     ASSERT(current_heap, "heap not initialized");
+    spinlock::guard _{ heap_lock };
     current_heap->free(p);
 }
 
@@ -366,9 +488,11 @@ void operator delete(void* p, std::align_val_t alignment) noexcept  // C++17
     // use default heap if possible
     ASSERT(current_heap, "heap not initialized");
     if (alignment <= static_cast<std::align_val_t>(current_heap->alignment())) {
-        return current_heap->free(p);
+        return operator delete(p);
     }
 
+    spinlock::guard _{ heap_lock };
+
     ASSERT(aligned_heap, "aligned heap not initialized");
     aligned_heap->free(reinterpret_cast<uintptr_t>(p));
 }
@@ -6,17 +6,39 @@
 #include <toyos/printf/backend.hpp>
 #include <toyos/x86/x86asm.hpp>
 
+#include <algorithm>
+
 static console* active_console{ nullptr };
 
-void console_serial_base::putc(char c)
+bool console_serial_base::wait_for_transmitter()
 {
+    // With enabled FIFOs, THB_EMPTY is only set when the whole transmitter FIFO is empty.
     unsigned retry_count{ 100000 };
     while (not(inb(base + LSR) & THB_EMPTY)) {
         if (--retry_count == 0) {
-            return;
+            return false;
+        }
+    }
+    return true;
+}
+
+void console_serial_base::write(const char* data, size_t size)
+{
+    while (size > 0) {
+        if (tx_budget == 0) {
+            if (not wait_for_transmitter()) {
+                return;
+            }
+            tx_budget = tx_fifo_depth;
         }
+
+        const size_t chunk{ std::min(size, tx_budget) };
+        outsb(base + THB, data, chunk);
+
+        data += chunk;
+        size -= chunk;
+        tx_budget -= chunk;
     }
-    outb(base + THB, c);
 }
 
 console_serial_base::console_serial_base(uint16_t port, unsigned baud)
@@ -30,6 +52,11 @@ console_serial_base::console_serial_base(uint16_t port, unsigned baud)
     outb(base + FCR, FCR_ENABLE | FCR_CLEAR);  // clear and enable FIFOs
     outb(base + MCR, MCR_DTR | MCR_RTS);       // make RTS and DTR active
 
+    // Only a 16550A reports working FIFOs. Older UARTs can take a single byte at a time.
+    if ((inb(base + IIR) & IIR_FIFO_ENABLED) == IIR_FIFO_ENABLED) {
+        tx_fifo_depth = TX_FIFO_DEPTH_16550A;
+    }
+
     // On some serial controllers this sequence can lead to a desynchronization
     // with the receiver, in which case the receiver goes into break state.
     // If we continue sending data immediately, the next couple frames can be
@@ -52,9 +79,16 @@ void console_serial::putchar(unsigned char c)
     }
 }
 
+void console_serial::putstr(const char* data, size_t size)
+{
+    if (active_console) {
+        active_console->write(data, size);
+    }
+}
+
 void serial_init(uint16_t port_begin)
 {
     static console_serial cons(port_begin, SERIAL_BAUD);
     active_console = &cons;
-    add_printf_backend(console_serial::putchar);
+    add_printf_backend(console_serial::putchar, console_serial::putstr);
 }
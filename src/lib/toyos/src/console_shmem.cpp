@@ -0,0 +1,112 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <toyos/boot.hpp>
+#include <toyos/console/console_shmem.hpp>
+#include <toyos/printf/backend.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static console* active_console{ nullptr };
+
+namespace
+{
+    enum
+    {
+        FULL_TIMEOUT = 10000000,
+    };
+}  // namespace
+
+bool console_shmem::init(const cbl::interval& region)
+{
+    static_assert(sizeof(lock_less_queue_t) % alignof(shmem::chunk) == 0);
+
+    // One slot is always kept free to tell a full queue from an empty one.
+    const size_t header_size{ sizeof(lock_less_queue_t) };
+    if (not shmem::region_usable(region, header_size + 2 * sizeof(shmem::chunk), { load_addr(), image_end() })) {
+        return false;
+    }
+
+    const size_t chunks{ std::min((region.size() - header_size) / sizeof(shmem::chunk) - 1, shmem::MAX_CHUNKS) };
+
+    auto* storage{ reinterpret_cast<shmem::producer::queue_storage*>(region.a) };
+    queue = shmem::producer::create(*storage, chunks);
+    return queue != nullptr;
+}
+
+bool console_shmem::wait_for_space()
+{
+    if (not reader_stalled) {
+        for (unsigned retry = FULL_TIMEOUT; retry > 0; retry--) {
+            if (not queue->full()) {
+                return true;
+            }
+            cpu_pause();
+        }
+    }
+
+    reader_stalled = queue->full();
+    return not reader_stalled;
+}
+
+void console_shmem::write(const char* data, size_t size)
+{
+    if (not queue) {
+        return;
+    }
+
+    if (dropped > 0 and not queue->full()) {
+        // Let the reader know about the gap before we continue.
+        shmem::chunk note;
+        const int len{ snprintf(note.data, sizeof(note.data), "[shmem: %lu bytes dropped]\n", dropped) };
+        note.size = static_cast<uint32_t>(std::min(static_cast<size_t>(len), sizeof(note.data)));
+        queue->push(note);
+        dropped = 0;
+    }
+
+    while (size > 0) {
+        if (queue->full() and not wait_for_space()) {
+            dropped += size;
+            return;
+        }
+
+        shmem::chunk c;
+        const size_t len{ std::min(size, sizeof(c.data)) };
+        memcpy(c.data, data, len);
+        c.size = static_cast<uint32_t>(len);
+        queue->push(c);
+
+        data += len;
+        size -= len;
+    }
+}
+
+void console_shmem::putchar(unsigned char c)
+{
+    if (active_console) {
+        active_console->putc(c);
+    }
+}
+
+void console_shmem::putstr(const char* data, size_t size)
+{
+    if (active_console) {
+        active_console->write(data, size);
+    }
+}
+
+bool shmem_console_init(const cbl::interval& region)
+{
+    static console_shmem cons;
+    if (not cons.init(region)) {
+        return false;
+    }
+
+    active_console = &cons;
+    add_printf_backend(console_shmem::putchar, console_shmem::putstr);
+    return true;
+}
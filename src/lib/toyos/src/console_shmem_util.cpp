@@ -0,0 +1,56 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#include <toyos/console/console_shmem_util.hpp>
+#include <toyos/util/literals.hpp>
+#include <toyos/util/string.hpp>
+
+namespace
+{
+    /// The boot page tables identity-map this much memory.
+    constexpr uint64_t IDENTITY_MAPPED_LIMIT{ 4_GiB };
+
+    std::optional<uint64_t> parse_number(const std::string& str)
+    {
+        const bool hex{ str.size() > 2 and str.compare(0, 2, "0x") == 0 };
+        const char* begin{ str.c_str() + (hex ? 2 : 0) };
+
+        char* end{ nullptr };
+        const uint64_t value{ strtoull(begin, &end, hex ? 16 : 10) };
+        if (end == begin or *end != '\0') {
+            return {};
+        }
+        return value;
+    }
+}  // namespace
+
+std::optional<cbl::interval> shmem::parse_region(const std::string& str)
+{
+    const auto parts{ util::string::split(str, ',') };
+    if (parts.size() != 2) {
+        return {};
+    }
+
+    const auto address{ parse_number(parts[0]) };
+    const auto size{ parse_number(parts[1]) };
+    if (not address or not size or *size > std::numeric_limits<uint64_t>::max() - *address) {
+        return {};
+    }
+    return cbl::interval::from_size(*address, *size);
+}
+
+bool shmem::region_usable(const cbl::interval& region, size_t min_size, const cbl::interval& image)
+{
+    if (region.b > IDENTITY_MAPPED_LIMIT or region.size() < min_size) {
+        return false;
+    }
+
+    // Setting up the queue would silently overwrite our own code and data, including the heap and the DMA pool.
+    return not region.intersects(image);
+}
@@ -0,0 +1,267 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <toyos/console/console_virtio.hpp>
+#include <toyos/printf/backend.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+static console* active_console{ nullptr };
+
+namespace
+{
+    // Layout of the ring page. The used ring has to be 4-byte aligned, the other parts less.
+    constexpr size_t AVAIL_RING_OFFSET{ sizeof(virtio::vq_desc) * console_virtio::QUEUE_SIZE };
+    constexpr size_t USED_RING_OFFSET{ 2 * AVAIL_RING_OFFSET };
+
+    static_assert(USED_RING_OFFSET + 2 * sizeof(uint16_t) + sizeof(virtio::vq_used_elem) * console_virtio::QUEUE_SIZE <= PAGE_SIZE);
+
+    enum
+    {
+        RING_FLAGS = 0,  ///< Index of the flags field in the avail and used rings.
+        RING_IDX = 1,    ///< Index of the idx field in the avail and used rings.
+        RING_START = 2,  ///< Index of the first ring entry in the avail ring.
+
+        RESET_TIMEOUT = 100000,
+        USED_TIMEOUT = 10000000,
+    };
+
+    /// Returns the virtual address of the structure a virtio capability points to, or nullptr for unusable BARs.
+    template<typename T>
+    volatile T* cap_target(const pci_device& dev, const volatile virtio::pci_cap& cap)
+    {
+        if (cap.bar >= PCI_NUM_BARS or not dev.bar(cap.bar)->is_mem()) {
+            return nullptr;
+        }
+        return reinterpret_cast<volatile T*>(dev.bar(cap.bar)->address() + cap.offset);
+    }
+
+    /// Finds the first virtio capability of the given type, or nullptr.
+    const volatile virtio::pci_cap* find_virtio_cap(const pci_device& dev, virtio::pci_cap::cfg_type type)
+    {
+        uint8_t off{ dev.cap_offset() };
+        while (off and off != 0xff) {
+            auto* cap = reinterpret_cast<const volatile virtio::pci_cap*>(uintptr_t(dev.cfg_base()) + off);
+            if (cap->id == pci::vendor_capability::ID and cap->type == type) {
+                return cap;
+            }
+            off = cap->next;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Hand the ring page at the given address to the device as the given queue and enable it.
+     *
+     * \return the number of entries of the queue, or nothing if the device does not have the queue.
+     */
+    std::optional<uint16_t> setup_queue(volatile virtio::common_cfg* cfg, uint16_t index, uintptr_t rings)
+    {
+        cfg->queue_select = index;
+        const uint16_t device_queue_size{ cfg->queue_size };
+        if (device_queue_size == 0) {
+            return {};
+        }
+
+        // Both sizes are powers of two, so the smaller one is one as well.
+        const uint16_t queue_size{ std::min(device_queue_size, static_cast<uint16_t>(console_virtio::QUEUE_SIZE)) };
+
+        // We poll the used ring, so the device does not have to interrupt us.
+        reinterpret_cast<volatile uint16_t*>(rings + AVAIL_RING_OFFSET)[RING_FLAGS] = virtio::AVAIL_F_NO_INTERRUPT;
+
+        cfg->queue_size = queue_size;
+        cfg->queue_msix_vector = virtio::NO_MSIX_VECTOR;
+        cfg->queue_desc_lo = static_cast<uint32_t>(rings);
+        cfg->queue_desc_hi = static_cast<uint32_t>(rings >> 32);
+        cfg->queue_driver_lo = static_cast<uint32_t>(rings + AVAIL_RING_OFFSET);
+        cfg->queue_driver_hi = static_cast<uint32_t>((rings + AVAIL_RING_OFFSET) >> 32);
+        cfg->queue_device_lo = static_cast<uint32_t>(rings + USED_RING_OFFSET);
+        cfg->queue_device_hi = static_cast<uint32_t>((rings + USED_RING_OFFSET) >> 32);
+        cfg->queue_enable = 1;
+
+        return queue_size;
+    }
+}  // namespace
+
+bool console_virtio::init(const pci_device& dev, const cbl::interval& dma_region)
+{
+    auto* common_cap = find_virtio_cap(dev, virtio::pci_cap::COMMON_CFG);
+    auto* notify_cap = find_virtio_cap(dev, virtio::pci_cap::NOTIFY_CFG);
+    if (not common_cap or not notify_cap) {
+        return false;
+    }
+
+    auto* cfg = cap_target<virtio::common_cfg>(dev, *common_cap);
+    auto* notify_base = cap_target<uint8_t>(dev, *notify_cap);
+    if (not cfg or not notify_base) {
+        return false;
+    }
+
+    dev.enable_memory_and_bus_master();
+
+    cfg->device_status = 0;
+    for (unsigned retry = RESET_TIMEOUT; cfg->device_status != 0; retry--) {
+        if (retry == 0) {
+            return false;
+        }
+        cpu_pause();
+    }
+
+    cfg->device_status = virtio::STATUS_ACKNOWLEDGE | virtio::STATUS_DRIVER;
+
+    // We only need the modern transport. Everything else, including multiport, stays off, so port 0 uses the
+    // first two queues.
+    cfg->device_feature_select = virtio::FEATURE_VERSION_1_SELECT;
+    if (not(cfg->device_feature & virtio::FEATURE_VERSION_1)) {
+        cfg->device_status = cfg->device_status | virtio::STATUS_FAILED;
+        return false;
+    }
+
+    cfg->driver_feature_select = 0;
+    cfg->driver_feature = 0;
+    cfg->driver_feature_select = virtio::FEATURE_VERSION_1_SELECT;
+    cfg->driver_feature = virtio::FEATURE_VERSION_1;
+
+    cfg->device_status = cfg->device_status | virtio::STATUS_FEATURES_OK;
+    if (not(cfg->device_status & virtio::STATUS_FEATURES_OK)) {
+        cfg->device_status = cfg->device_status | virtio::STATUS_FAILED;
+        return false;
+    }
+
+    const uintptr_t rings{ dma_region.a };
+    const uintptr_t receive_rings{ rings + PAGE_SIZE };
+    memset(reinterpret_cast<void*>(rings), 0, 2 * PAGE_SIZE);
+
+    desc = reinterpret_cast<volatile virtio::vq_desc*>(rings);
+    avail = reinterpret_cast<volatile uint16_t*>(rings + AVAIL_RING_OFFSET);
+    used = reinterpret_cast<volatile uint16_t*>(rings + USED_RING_OFFSET);
+    buffers = reinterpret_cast<char*>(rings + 2 * PAGE_SIZE);
+
+    for (uint16_t i = 0; i < QUEUE_SIZE; i++) {
+        desc[i].addr = uintptr_t(buffers + i * BUFFER_SIZE);
+    }
+
+    // The receive queue never gets any buffers, so input is dropped.
+    const auto receive_queue_size{ setup_queue(cfg, virtio::CONSOLE_RECEIVE_QUEUE, receive_rings) };
+    const auto transmit_queue_size{ setup_queue(cfg, virtio::CONSOLE_TRANSMIT_QUEUE, rings) };
+    if (not receive_queue_size or not transmit_queue_size) {
+        cfg->device_status = cfg->device_status | virtio::STATUS_FAILED;
+        return false;
+    }
+
+    queue_size = *transmit_queue_size;
+    for (uint16_t i = 0; i < queue_size; i++) {
+        free_ids[free_count++] = i;
+    }
+
+    // The transmit queue is still selected.
+    auto* notify = static_cast<const volatile virtio::pci_notify_cap*>(notify_cap);
+    notify_addr = reinterpret_cast<volatile uint16_t*>(notify_base + cfg->queue_notify_off * notify->notify_off_multiplier);
+
+    cfg->device_status = cfg->device_status | virtio::STATUS_DRIVER_OK;
+
+    return true;
+}
+
+void console_virtio::reap()
+{
+    auto* elems = reinterpret_cast<volatile virtio::vq_used_elem*>(used + RING_START);
+
+    const uint16_t used_idx{ used[RING_IDX] };
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    for (; last_used_idx != used_idx; last_used_idx++) {
+        free_ids[free_count++] = static_cast<uint16_t>(elems[last_used_idx % queue_size].id);
+    }
+}
+
+std::optional<uint16_t> console_virtio::take_descriptor()
+{
+    for (unsigned retry = USED_TIMEOUT; free_count == 0; retry--) {
+        if (retry == 0) {
+            broken = true;
+            return {};
+        }
+        reap();
+        cpu_pause();
+    }
+    return free_ids[--free_count];
+}
+
+void console_virtio::publish()
+{
+    // The descriptors and ring entries have to be visible before the device sees the new index.
+    std::atomic_thread_fence(std::memory_order_release);
+    avail[RING_IDX] = avail_idx;
+    *notify_addr = virtio::CONSOLE_TRANSMIT_QUEUE;
+}
+
+void console_virtio::write(const char* data, size_t size)
+{
+    if (not notify_addr or broken) {
+        return;
+    }
+
+    // Reclaim what the device already finished, so a short write rarely has to wait.
+    reap();
+
+    uint16_t queued{ 0 };
+    while (size > 0) {
+        // Publish what we have before waiting for the device, or it would wait for us.
+        if (free_count == 0 and queued > 0) {
+            publish();
+            queued = 0;
+        }
+
+        auto id = take_descriptor();
+        if (not id) {
+            return;
+        }
+
+        const size_t chunk{ std::min(size, BUFFER_SIZE) };
+        memcpy(buffers + *id * BUFFER_SIZE, data, chunk);
+
+        desc[*id].len = static_cast<uint32_t>(chunk);
+        desc[*id].flags = 0;
+        avail[RING_START + avail_idx % queue_size] = *id;
+        avail_idx++;
+        queued++;
+
+        data += chunk;
+        size -= chunk;
+    }
+
+    if (queued > 0) {
+        publish();
+    }
+}
+
+void console_virtio::putchar(unsigned char c)
+{
+    if (active_console) {
+        active_console->putc(c);
+    }
+}
+
+void console_virtio::putstr(const char* data, size_t size)
+{
+    if (active_console) {
+        active_console->write(data, size);
+    }
+}
+
+bool virtio_console_init(const pci_device& dev, const cbl::interval& dma_region)
+{
+    static console_virtio cons;
+    if (not cons.init(dev, dma_region)) {
+        return false;
+    }
+
+    active_console = &cons;
+    add_printf_backend(console_virtio::putchar, console_virtio::putstr);
+    return true;
+}
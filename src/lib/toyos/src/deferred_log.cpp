@@ -0,0 +1,72 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/int_guard.hpp>
+#include <toyos/util/deferred_log.hpp>
+#include <toyos/util/simple_ring_buffer.hpp>
+#include <toyos/util/trace.hpp>
+
+#include <optional>
+
+namespace
+{
+    struct cpu_log
+    {
+        std::optional<cbl::simple_ring_buffer<deferred_log::entry>> ring;
+
+        /// Set while the messages are printed, so a failing ASSERT() in there does not print them again.
+        bool draining{ false };
+    };
+
+    cpu_log logs[smp::MAX_CPUS];
+
+    cpu_log& this_cpu_log()
+    {
+        auto& log{ logs[smp::current_cpu()] };
+        if (not log.ring) {
+            log.ring.emplace(deferred_log::CAPACITY);
+        }
+        return log;
+    }
+}  // namespace
+
+void deferred_log::init(size_t cpus)
+{
+    for (size_t cpu = 0; cpu < cpus and cpu < smp::MAX_CPUS; cpu++) {
+        if (not logs[cpu].ring) {
+            logs[cpu].ring.emplace(CAPACITY);
+        }
+    }
+}
+
+void deferred_log::add(const entry& e)
+{
+    // The message may come from an interrupt handler, which must not interrupt us in the middle of adding another one.
+    int_guard _;
+    this_cpu_log().ring->add(e);
+}
+
+void deferred_log::drain()
+{
+    // Nothing was logged on this CPU if it has no ring. Not allocating one here keeps drain() safe for ASSERT().
+    auto& log{ logs[smp::current_cpu()] };
+    if (not log.ring or log.draining or log.ring->size() == 0) {
+        return;
+    }
+
+    int_guard _;
+    log.draining = true;
+
+    auto& ring{ *log.ring };
+
+    const uint64_t first_tsc{ ring.at(0).tsc };
+    for (size_t i = 0; i < ring.size(); i++) {
+        const auto& e{ ring.at(i) };
+        e.print(e, e.tsc - first_tsc);
+    }
+    ring.flush();
+
+    log.draining = false;
+}
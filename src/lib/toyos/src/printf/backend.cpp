@@ -2,51 +2,261 @@
 //
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <config.hpp>
+
 #include <toyos/printf/backend.hpp>
 #include <toyos/printf/xprintf.h>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/int_guard.hpp>
+#include <toyos/util/binlog.hpp>
+#include <toyos/util/spinlock.hpp>
+#include <toyos/x86/x86asm.hpp>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 
 // The library could be used in context where dynamic memory allocation
 // is unsupported, e.g. in early boot stages.
 // Hence, the number of possible backends is fixed.
 static constexpr size_t MAX_BACKENDS{ 3 };
 
-static std::array<printf_backend_fn, MAX_BACKENDS> backends;
+struct printf_backend
+{
+    printf_backend_fn putc;
+    printf_bulk_backend_fn write;  ///< optional
+};
+
+static std::array<printf_backend, MAX_BACKENDS> backends;
+
+static void write_to_backends(const char* data, size_t size)
+{
+    for (const auto& backend : backends) {
+        if (backend.write != nullptr) {
+            backend.write(data, size);
+        }
+        else if (backend.putc != nullptr) {
+            for (size_t i = 0; i < size; i++) {
+                backend.putc(static_cast<unsigned char>(data[i]));
+            }
+        }
+    }
+}
+
+/*
+ * Output is collected in per-CPU line buffers and handed to the backends a
+ * line at a time, so backends can transfer many characters at once.
+ *
+ * As soon as more than one CPU is online, complete lines are committed into a
+ * bounded multi-producer queue. Whichever CPU manages to take the drain lock
+ * becomes the output owner and writes all committed lines to the backends, in
+ * the order in which they were committed. Other CPUs never wait for the
+ * (potentially slow) backends, unless the queue is full.
+ *
+ * The line buffer and the drain lock are also used by interrupt handlers that
+ * print, so they are only touched with interrupts disabled. Otherwise, a
+ * handler could corrupt a half-written line or spin forever on a full queue
+ * while the code it interrupted holds the drain lock.
+ */
+namespace
+{
+    constexpr size_t LINE_LENGTH{ 160 };
+    constexpr size_t QUEUE_LINES{ 64 };
+
+    static_assert(binlog::MAX_RECORD_SIZE <= LINE_LENGTH, "A binary log record has to fit into a line");
+
+    struct line
+    {
+        size_t length;
+        std::array<char, LINE_LENGTH> chars;
+    };
+
+    struct alignas(CPU_CACHE_LINE_SIZE) line_buffer
+    {
+        line pending;
+    };
+
+    line_buffer line_buffers[smp::MAX_CPUS];
+
+    /**
+     * A queue position maps to slot (position % QUEUE_LINES) in round (position / QUEUE_LINES).
+     * A slot is free for round r if its state is 2r and full if it is 2r + 1. All slots start out
+     * free for round 0.
+     */
+    struct alignas(CPU_CACHE_LINE_SIZE) queue_slot
+    {
+        std::atomic<size_t> state;
+        line data;
+    };
+
+    queue_slot queue[QUEUE_LINES];
+
+    std::atomic<size_t> queue_tail{ 0 };
+    size_t queue_head{ 0 };  ///< only accessed by the output owner
+
+    spinlock drain_lock;
+
+    size_t free_state(size_t position)
+    {
+        return 2 * (position / QUEUE_LINES);
+    }
+
+    size_t full_state(size_t position)
+    {
+        return free_state(position) + 1;
+    }
+
+    queue_slot& slot_at(size_t position)
+    {
+        return queue[position % QUEUE_LINES];
+    }
+
+    bool line_ready(size_t position)
+    {
+        return slot_at(position).state.load(std::memory_order_acquire) == full_state(position);
+    }
+
+    /// Write out all committed lines, unless another CPU is already doing that.
+    void drain()
+    {
+        while (drain_lock.try_lock()) {
+            while (line_ready(queue_head)) {
+                auto& slot{ slot_at(queue_head) };
+                write_to_backends(slot.data.chars.data(), slot.data.length);
+                slot.state.store(free_state(queue_head + QUEUE_LINES), std::memory_order_release);
+                queue_head++;
+            }
+
+            const size_t head{ queue_head };
+            drain_lock.unlock();
+
+            // A line committed after the last check relies on us, because its CPU failed to take the lock.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (not line_ready(head)) {
+                return;
+            }
+        }
+    }
+
+    void commit(line& pending)
+    {
+        // With a single CPU, there is nobody to interleave with.
+        if (smp::cpu_count() == 1) {
+            write_to_backends(pending.chars.data(), pending.length);
+            pending.length = 0;
+            return;
+        }
+
+        const size_t position{ queue_tail.fetch_add(1) };
+        auto& slot{ slot_at(position) };
+
+        // The queue is full. Help writing out lines until our slot is free.
+        while (slot.state.load(std::memory_order_acquire) != free_state(position)) {
+            drain();
+            cpu_pause();
+        }
+
+        slot.data = pending;
+        slot.state.store(full_state(position), std::memory_order_release);
+        pending.length = 0;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        drain();
+    }
+}  // namespace
 
 void print_to_all_backends(unsigned char c)
 {
-    for (const auto& print_fn : backends) {
-        if (print_fn != nullptr) {
-            print_fn(c);
+    int_guard _;
+    auto& pending{ line_buffers[smp::current_cpu()].pending };
+    pending.chars[pending.length++] = static_cast<char>(c);
+
+    if (c == '\n' or pending.length == pending.chars.size()) {
+        commit(pending);
+    }
+}
+
+void print_string_to_all_backends(const char* data, size_t size)
+{
+    int_guard _;
+    auto& pending{ line_buffers[smp::current_cpu()].pending };
+
+    while (size > 0) {
+        const size_t space{ pending.chars.size() - pending.length };
+        const char* end{ data + std::min(size, space) };
+        const char* newline{ std::find(data, end, '\n') };
+        const bool complete{ newline != end };
+        if (complete) {
+            end = newline + 1;
+        }
+
+        std::copy(data, end, pending.chars.begin() + pending.length);
+        pending.length += end - data;
+        size -= end - data;
+        data = end;
+
+        if (complete or pending.length == pending.chars.size()) {
+            commit(pending);
+        }
+    }
+}
+
+void print_record_to_all_backends(const char* data, size_t size)
+{
+    // Output can be redirected, for example while test cases run in parallel.
+    if (xfunc_out and xfunc_out != print_to_all_backends) {
+        for (size_t i = 0; i < size; i++) {
+            xfunc_out(static_cast<unsigned char>(data[i]));
         }
+        return;
+    }
+
+    int_guard _;
+    auto& pending{ line_buffers[smp::current_cpu()].pending };
+    if (pending.length + size > pending.chars.size()) {
+        commit(pending);
+    }
+
+    std::copy(data, data + size, pending.chars.begin() + pending.length);
+    pending.length += size;
+    commit(pending);
+}
+
+void flush_printf_backends()
+{
+    int_guard _;
+    auto& pending{ line_buffers[smp::current_cpu()].pending };
+    if (pending.length > 0) {
+        commit(pending);
     }
 }
 
-void add_printf_backend(printf_backend_fn backend)
+void add_printf_backend(printf_backend_fn backend, printf_bulk_backend_fn bulk_backend)
 {
-    auto free_slot{ std::find(backends.begin(), backends.end(), nullptr) };
+    auto free_slot{ std::find_if(backends.begin(), backends.end(), [](const auto& b) { return b.putc == nullptr; }) };
     if (free_slot == backends.end()) {
         // no more space - alert on already registered backends
         puts("maximum number of printf backends already registered");
+        flush_printf_backends();
         __builtin_trap();
     }
-    *free_slot = backend;
+    *free_slot = { backend, bulk_backend };
 
     // backends are expected to be seldom added/removed, so re-registering
     // on every call ain't harmful
     xdev_out(print_to_all_backends);
+    xdev_out_bulk(print_string_to_all_backends);
 }
 
 void remove_printf_backend(printf_backend_fn backend)
 {
-    auto existing = std::find(backends.begin(), backends.end(), backend);
+    auto existing = std::find_if(backends.begin(), backends.end(), [backend](const auto& b) { return b.putc == backend; });
     if (existing != backends.end()) {
-        *existing = nullptr;
+        *existing = {};
     }
 }
 
 void remove_all_printf_backends()
 {
-    backends.fill(nullptr);
+    backends.fill({});
 }
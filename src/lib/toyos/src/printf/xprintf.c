@@ -19,7 +19,8 @@
 static char* const max_ptr = (char*)-1;
 
 #if _USE_XFUNC_OUT
-void (*xfunc_out)(unsigned char); /* Pointer to the output stream */
+void (*xfunc_out)(unsigned char);                    /* Pointer to the output stream */
+void (*xfunc_out_bulk)(const char*, unsigned long); /* Optional bulk output to the same stream */
 
 #ifndef LIB_TYPE_HOSTED
 /*----------------------------------------------*/
@@ -74,6 +75,36 @@ int puts_internal(const char* str, char** outptr, char* outptr_limit)
     return 0;
 }
 
+/*----------------------------------------------*/
+/* Put a string of known length                 */
+/*----------------------------------------------*/
+
+static void puts_n_internal(const char* str, unsigned long len, char** outptr, char* outptr_limit)
+{
+    if (outptr || !xfunc_out_bulk) {
+        while (len--) {
+            putc_internal(*str++, outptr, outptr_limit);
+        }
+        return;
+    }
+
+    /* Hand everything up to a newline to the bulk output at once. */
+    const char* chunk = str;
+    for (const char* end = str + len; str < end; str++) {
+        if (_CR_CRLF && *str == '\n') {
+            xfunc_out_bulk(chunk, str - chunk);
+            xfunc_out_bulk("\r", 1); /* CR -> CRLF */
+            chunk = str;
+        }
+    }
+    xfunc_out_bulk(chunk, str - chunk);
+}
+
+void xputs_n(const char* str, unsigned long len)
+{
+    puts_n_internal(str, len, 0, max_ptr);
+}
+
 /*------------------------------------------------------*/
 /* Put a null-terminated string with a trailing newline */
 /*------------------------------------------------------*/
@@ -102,20 +133,80 @@ int puts(const char* str)
     xprintf("%f", 10.0);            <xprintf lacks floating point support>
 */
 
-enum
+static void put_padding(char c, unsigned int n, char** outptr, char* outptr_limit)
+{
+    static const char spaces[] = "                ";
+    static const char zeros[] = "0000000000000000";
+
+    while (n) {
+        unsigned int chunk = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+        puts_n_internal(c == '0' ? zeros : spaces, chunk, outptr, outptr_limit);
+        n -= chunk;
+    }
+}
+
+static void put_string_internal(const char* p, unsigned int f, unsigned int w, char** outptr, char* outptr_limit)
+{
+    unsigned int j;
+
+    for (j = 0; p[j]; j++)
+        ;
+
+    if (!(f & FLAG_LEFT_JUSTIFIED) && j < w) {
+        put_padding(' ', w - j, outptr, outptr_limit);
+    }
+    puts_n_internal(p, j, outptr, outptr_limit);
+    if ((f & FLAG_LEFT_JUSTIFIED) && j < w) {
+        put_padding(' ', w - j, outptr, outptr_limit);
+    }
+}
+
+static void put_number_internal(unsigned long long v, unsigned int r, unsigned int f, unsigned int w, int lowercase,
+                                char** outptr, char* outptr_limit)
+{
+    unsigned int i;
+    char s[66], d; /* 64 binary digits and a sign */
+
+    /* Digits are collected from the end, so they can be written at once. */
+    i = sizeof(s);
+    do {
+        d = (char)(v % r);
+        v /= r;
+        if (d > 9)
+            d += lowercase ? 0x27 : 0x07;
+        s[--i] = d + '0';
+    } while (v);
+
+    if (f & FLAG_SIGNED_NEGATIVE) {
+        s[--i] = '-';
+    }
+
+    unsigned int len = sizeof(s) - i;
+
+    if (!(f & FLAG_LEFT_JUSTIFIED) && len < w) {
+        put_padding((f & FLAG_ZERO_PADDING) ? '0' : ' ', w - len, outptr, outptr_limit);
+    }
+    puts_n_internal(s + i, len, outptr, outptr_limit);
+    if ((f & FLAG_LEFT_JUSTIFIED) && len < w) {
+        put_padding(' ', w - len, outptr, outptr_limit);
+    }
+}
+
+void xput_string(const char* str, unsigned int f, unsigned int w)
 {
-    FLAG_ZERO_PADDING = 1u << 0,
-    FLAG_LEFT_JUSTIFIED = 1u << 1,
-    FLAG_SIZE_LONG = 1u << 2,
-    FLAG_SIZE_LONG_LONG = 1u << 3,
-    FLAG_SIGNED_NEGATIVE = 1u << 4,
-    FLAG_SIZE_POINTER = 1u << 5,
-};
+    put_string_internal(str, f, w, 0, max_ptr);
+}
+
+void xput_number(unsigned long long v, unsigned int r, unsigned int f, unsigned int w, int lowercase)
+{
+    put_number_internal(v, r, f, w, lowercase, 0, max_ptr);
+}
+
 static void xvprintf_internal(const char* fmt, va_list arp, char** outptr, char* outptr_limit)
 {
-    unsigned int r, i, j, w, f;
+    unsigned int r, w, f;
     unsigned long long v;
-    char s[32], c, d, *p;
+    char c, d;
 
     for (;;) {
         c = *fmt++;
@@ -175,16 +266,7 @@ static void xvprintf_internal(const char* fmt, va_list arp, char** outptr, char*
 
         switch (d) {  /* Type is... */
             case 'S': /* String */
-                p = va_arg(arp, char*);
-                for (j = 0; p[j]; j++)
-                    ;
-                while (!(f & FLAG_LEFT_JUSTIFIED) && j++ < w) {
-                    putc_internal(' ', outptr, outptr_limit);
-                }
-                puts_internal(p, outptr, outptr_limit);
-                while (j++ < w) {
-                    putc_internal(' ', outptr, outptr_limit);
-                }
+                put_string_internal(va_arg(arp, char*), f, w, outptr, outptr_limit);
                 continue;
             case 'C': /* Character */
                 putc_internal((char)va_arg(arp, int), outptr, outptr_limit);
@@ -230,33 +312,7 @@ static void xvprintf_internal(const char* fmt, va_list arp, char** outptr, char*
             f |= FLAG_SIGNED_NEGATIVE;
         }
 
-        i = 0;
-        do {
-            d = (char)(v % r);
-            v /= r;
-            if (d > 9)
-                d += (c == 'x') ? 0x27 : 0x07;
-            s[i++] = d + '0';
-        } while (v && i < sizeof(s));
-
-        if (f & FLAG_SIGNED_NEGATIVE) {
-            s[i++] = '-';
-        }
-
-        j = i;
-        d = (f & FLAG_ZERO_PADDING) ? '0' : ' ';
-
-        while (!(f & FLAG_LEFT_JUSTIFIED) && j++ < w) {
-            putc_internal(d, outptr, outptr_limit);
-        }
-
-        do {
-            putc_internal(s[--i], outptr, outptr_limit);
-        } while (i);
-
-        while (j++ < w) {
-            putc_internal(' ', outptr, outptr_limit);
-        }
+        put_number_internal(v, r, f, w, c == 'x', outptr, outptr_limit);
     }
 }
 
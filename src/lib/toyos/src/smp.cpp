@@ -0,0 +1,404 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <compiler.hpp>
+#include <config.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include <toyos/acpi.hpp>
+#include <toyos/boot.hpp>
+#include <toyos/per_cpu.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/irq_handler.hpp>
+#include <toyos/testhelper/lapic_enabler.hpp>
+#include <toyos/testhelper/lapic_test_tools.hpp>
+#include <toyos/util/math.hpp>
+#include <toyos/util/spinlock.hpp>
+#include <toyos/util/trace.hpp>
+#include <toyos/x86/cpuid.hpp>
+#include <toyos/x86/segmentation.hpp>
+#include <toyos/x86/x86asm.hpp>
+#include <toyos/x86/x86defs.hpp>
+
+#include <first-fit-heap/heap.hpp>
+
+extern char ap_trampoline_start[];
+extern char ap_trampoline_end[];
+
+/// Stack pointer the next AP starts with. Used by ap_trampoline.S.
+EXTERN_C uintptr_t ap_boot_stack;
+uintptr_t ap_boot_stack{ 0 };
+
+namespace
+{
+    // The kernel GDT in init.S has 6 segment descriptors and a 16 byte TSS descriptor.
+    constexpr size_t GDT_ENTRIES{ 8 };
+
+    struct alignas(CPU_CACHE_LINE_SIZE) cpu_state
+    {
+        // 104 bytes at a 128 byte boundary never cross a page boundary.
+        alignas(128) x86::tss tss;
+        std::array<uint64_t, GDT_ENTRIES> gdt;
+
+        uint32_t apic_id{ 0 };
+        std::atomic<bool> online{ false };
+        std::atomic<const std::function<void()>*> work{ nullptr };
+    };
+
+    cpu_state cpus[smp::MAX_CPUS];
+    alignas(PAGE_SIZE) char ap_stacks[smp::MAX_CPUS][STACK_SIZE_PHYS];
+
+    smp::per_cpu per_cpu_areas[smp::MAX_CPUS];
+
+    /// Size of the heap arena of each AP. The BSP directly uses the global heap.
+    constexpr size_t ARENA_SIZE{ 32 * 1024 };
+
+    struct heap_arena
+    {
+        // Usually only taken by the owning CPU, unless another CPU frees memory from this arena.
+        spinlock lock;
+
+        std::optional<fixed_memory> memory;
+        std::optional<first_fit_heap<HEAP_ALIGNMENT>> heap;
+    };
+
+    heap_arena arenas[smp::MAX_CPUS];
+    alignas(PAGE_SIZE) char arena_memory[smp::MAX_CPUS][ARENA_SIZE];
+
+    size_t num_cpus{ 1 };
+
+    /// Number of the AP that is currently booting.
+    std::atomic<size_t> booting_cpu{ 0 };
+
+    // Control register state of the BSP that APs adopt.
+    uint64_t bsp_cr0{ 0 };
+    uint64_t bsp_cr4{ 0 };
+    uint64_t bsp_efer{ 0 };
+
+    // The TSC frequency is unknown without a calibration that takes a long time. Assume the fastest plausible TSC
+    // instead, so delays are never shorter than requested.
+    constexpr uint64_t MAX_TSC_TICKS_PER_US{ 5000 };
+
+    // Delays recommended by Intel SDM Vol. 3, 9.4.4.1 Typical BSP Initialization Sequence.
+    constexpr uint64_t INIT_DELAY_US{ 10000 };
+    constexpr uint64_t SIPI_DELAY_US{ 200 };
+
+    // Time an AP gets to report itself online after the second STARTUP IPI.
+    constexpr uint64_t ONLINE_TIMEOUT_US{ 100000 };
+
+    /// Wait until the given condition is true or the timeout expired. Returns the condition.
+    template<typename COND>
+    bool wait_until(COND cond, uint64_t timeout_us)
+    {
+        const uint64_t end{ rdtsc() + timeout_us * MAX_TSC_TICKS_PER_US };
+        while (not cond()) {
+            if (rdtsc() > end) {
+                return cond();
+            }
+            cpu_pause();
+        }
+        return true;
+    }
+
+    /// Point the GS base of the current CPU to its per-CPU area.
+    void setup_per_cpu_area(size_t cpu)
+    {
+        auto& area{ per_cpu_areas[cpu] };
+        area.self = &area;
+        area.cpu = cpu;
+        wrmsr(x86::msr::GS_BASE, ptr_to_num(&area));
+    }
+
+    uint32_t initial_apic_id()
+    {
+        if (cpuid(CPUID_LEAF_MAX_LEVEL_VENDOR_ID).eax >= CPUID_LEAF_EXTENDED_TOPOLOGY) {
+            auto topology{ cpuid(CPUID_LEAF_EXTENDED_TOPOLOGY) };
+            if (topology.ebx != 0) {
+                return topology.edx;
+            }
+        }
+        return cpuid(CPUID_LEAF_FAMILY_FEATURES).ebx >> lapic_test_tools::LAPIC_ID_SHIFT;
+    }
+
+    bool apic_id_known(uint32_t apic_id)
+    {
+        for (size_t cpu{ 0 }; cpu < num_cpus; cpu++) {
+            if (cpus[cpu].apic_id == apic_id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * \brief Start an AP via INIT-SIPI-SIPI.
+     *
+     * \return whether the AP came online
+     */
+    bool boot_ap(size_t cpu, uint32_t apic_id)
+    {
+        using namespace lapic_test_tools;
+
+        auto& state{ cpus[cpu] };
+        state.apic_id = apic_id;
+
+        booting_cpu.store(cpu);
+        ap_boot_stack = ptr_to_num(&ap_stacks[cpu][STACK_SIZE_PHYS]);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto is_online{ [&state] { return state.online.load(std::memory_order_acquire); } };
+        auto destination{ static_cast<uint8_t>(apic_id) };
+        auto sipi_vector{ static_cast<uint8_t>(AP_TRAMPOLINE_ADDR >> PAGE_BITS) };
+
+        send_ipi(0, destination, dest_sh::NO_SH, dest_mode::PHYSICAL, lvt_dlv_mode::INIT);
+        wait_until([] { return false; }, INIT_DELAY_US);
+
+        send_ipi(sipi_vector, destination, dest_sh::NO_SH, dest_mode::PHYSICAL, lvt_dlv_mode::START_UP);
+        if (not wait_until(is_online, SIPI_DELAY_US)) {
+            send_ipi(sipi_vector, destination, dest_sh::NO_SH, dest_mode::PHYSICAL, lvt_dlv_mode::START_UP);
+        }
+
+        if (not wait_until(is_online, ONLINE_TIMEOUT_US)) {
+            // Park the AP, so it does not wake up later using the state of the next AP.
+            send_ipi(0, destination, dest_sh::NO_SH, dest_mode::PHYSICAL, lvt_dlv_mode::INIT);
+            warning("CPU with APIC ID {} did not come online", apic_id);
+            return false;
+        }
+
+        return true;
+    }
+
+}  // namespace
+
+/// Set up the per-CPU area of the BSP, called by init.S before the first allocation.
+EXTERN_C void init_bsp_per_cpu_area()
+{
+    setup_per_cpu_area(0);
+}
+
+/**
+ * \brief C++ entry point of APs, called by ap_trampoline.S.
+ *
+ * Sets up the CPU like the BSP and then waits for work.
+ */
+EXTERN_C [[noreturn]] void ap_entry()
+{
+    const size_t cpu{ booting_cpu.load() };
+    auto& self{ cpus[cpu] };
+
+    setup_per_cpu_area(cpu);
+
+    auto& arena{ arenas[cpu] };
+    if (not arena.heap) {
+        arena.memory.emplace(ptr_to_num(arena_memory[cpu]), ARENA_SIZE);
+        arena.heap.emplace(*arena.memory);
+    }
+
+    set_cr0(bsp_cr0);
+    set_cr4(bsp_cr4);
+    wrmsr(x86::msr::EFER, bsp_efer);
+
+    // Every CPU needs its own copy of the GDT for its TSS.
+    auto gdtr{ get_current_gdtr() };
+    ASSERT(size_t(gdtr.limit) + 1 <= sizeof(self.gdt), "kernel GDT too large");
+    memcpy(self.gdt.data(), num_to_ptr<void>(gdtr.base), gdtr.limit + 1);
+    set_current_gdtr({ gdtr.limit, ptr_to_num(self.gdt.data()) });
+    load_tss(self.tss);
+
+    global_idt.load();
+
+    self.online.store(true, std::memory_order_release);
+
+    while (true) {
+        const std::function<void()>* work;
+        while (not(work = self.work.load(std::memory_order_acquire))) {
+            cpu_pause();
+        }
+
+        (*work)();
+
+        self.work.store(nullptr, std::memory_order_release);
+    }
+}
+
+void smp::init()
+{
+    static bool initialized{ false };
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    cpus[0].apic_id = initial_apic_id();
+    cpus[0].online = true;
+
+    const acpi_madt* madt{ find_madt(get_boot_rsdp()) };
+    if (not madt) {
+        warning("No MADT found, only the BSP is available");
+        return;
+    }
+
+    memcpy(num_to_ptr<void>(AP_TRAMPOLINE_ADDR), ap_trampoline_start, ap_trampoline_end - ap_trampoline_start);
+
+    bsp_cr0 = get_cr0();
+    bsp_cr4 = get_cr4() & ~math::mask_from(x86::cr4::VMXE);
+    bsp_efer = rdmsr(x86::msr::EFER);
+
+    lapic_enabler _;
+
+    for (const auto& entry : madt->entries()) {
+        std::optional<uint32_t> apic_id;
+
+        if (entry.type == acpi_madt_entry::LOCAL_APIC) {
+            const auto& lapic{ static_cast<const acpi_madt_local_apic&>(entry) };
+            if (lapic.enabled()) {
+                apic_id = lapic.apic_id;
+            }
+        }
+        else if (entry.type == acpi_madt_entry::LOCAL_X2APIC) {
+            const auto& x2apic{ static_cast<const acpi_madt_local_x2apic&>(entry) };
+            if (x2apic.enabled()) {
+                apic_id = x2apic.x2apic_id;
+            }
+        }
+
+        if (not apic_id or apic_id_known(*apic_id)) {
+            continue;
+        }
+
+        if (*apic_id > lapic_test_tools::LAPIC_ID_MASK) {
+            warning("Skipping CPU with APIC ID {}, which is not addressable in xAPIC mode", *apic_id);
+            continue;
+        }
+
+        if (num_cpus == MAX_CPUS) {
+            warning("Only {} CPUs are supported", MAX_CPUS);
+            break;
+        }
+
+        if (boot_ap(num_cpus, *apic_id)) {
+            num_cpus++;
+        }
+    }
+
+    info("{} CPUs online", num_cpus);
+}
+
+size_t smp::cpu_count()
+{
+    return num_cpus;
+}
+
+size_t smp::current_cpu()
+{
+    return this_cpu().cpu;
+}
+
+uint32_t smp::apic_id(size_t cpu)
+{
+    ASSERT(cpu < num_cpus, "Invalid CPU {}", cpu);
+    return cpus[cpu].apic_id;
+}
+
+void smp::start_on(size_t cpu, const std::function<void()>& fn)
+{
+    ASSERT(cpu > 0 and cpu < num_cpus, "Invalid AP {}", cpu);
+
+    const std::function<void()>* idle{ nullptr };
+    PANIC_UNLESS(cpus[cpu].work.compare_exchange_strong(idle, &fn, std::memory_order_acq_rel), "CPU {} is busy", cpu);
+}
+
+void smp::wait_for(size_t cpu)
+{
+    ASSERT(cpu > 0 and cpu < num_cpus, "Invalid AP {}", cpu);
+
+    while (cpus[cpu].work.load(std::memory_order_acquire)) {
+        cpu_pause();
+    }
+}
+
+void smp::run_together(const std::vector<size_t>& cpus, const std::function<void(size_t)>& fn)
+{
+    std::atomic<size_t> ready{ 0 };
+    std::vector<std::function<void()>> work;
+    work.reserve(cpus.size());
+
+    for (size_t i = 0; i < cpus.size(); i++) {
+        work.emplace_back([&ready, &cpus, &fn, i] {
+            ready++;
+            while (ready.load() < cpus.size()) {
+                cpu_pause();
+            }
+            fn(i);
+        });
+    }
+
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] != 0) {
+            start_on(cpus[i], work[i]);
+        }
+    }
+
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] == 0) {
+            work[i]();
+        }
+    }
+
+    for (auto cpu : cpus) {
+        if (cpu != 0) {
+            wait_for(cpu);
+        }
+    }
+}
+
+smp::per_cpu& smp::cpu_area(size_t cpu)
+{
+    ASSERT(cpu < num_cpus, "Invalid CPU {}", cpu);
+    return per_cpu_areas[cpu];
+}
+
+void* smp::arena_alloc(size_t size)
+{
+    auto& self{ this_cpu() };
+    auto& arena{ arenas[self.cpu] };
+    if (not arena.heap) {
+        return nullptr;
+    }
+
+    void* p;
+    {
+        spinlock::guard _{ arena.lock };
+        p = arena.heap->alloc(size);
+    }
+
+    if (p) {
+        self.stats.arena_allocations++;
+    }
+    return p;
+}
+
+bool smp::arena_free(void* p)
+{
+    const uintptr_t addr{ ptr_to_num(p) };
+    const uintptr_t base{ ptr_to_num(arena_memory) };
+    if (addr < base or addr >= base + sizeof(arena_memory)) {
+        return false;
+    }
+
+    const size_t owner{ (addr - base) / ARENA_SIZE };
+    auto& self{ this_cpu() };
+    if (owner != self.cpu) {
+        self.stats.remote_frees++;
+    }
+
+    spinlock::guard _{ arenas[owner].lock };
+    arenas[owner].heap->free(p);
+    return true;
+}
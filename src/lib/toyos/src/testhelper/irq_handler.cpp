@@ -2,6 +2,7 @@
 //
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <toyos/printf/backend.hpp>
 #include <toyos/testhelper/idt.hpp>
 #include <toyos/testhelper/irq_handler.hpp>
 #include <toyos/x86/x86asm.hpp>
@@ -22,6 +23,7 @@ void irq_entry(intr_regs* regs)
     else {
         info("NO INTERRUPT HANDLER DEFINED");
         info("{s}: vector {#x} error code {#x} ip {#x}, ", __func__, regs->vector, regs->error_code, regs->rip);
+        flush_printf_backends();
         disable_interrupts_and_halt();
     }
 }
@@ -203,6 +203,20 @@ uint32_t lapic_test_tools::ticks_per_second(uint32_t divisor)
     return ticks_per_second * divisor;
 }
 
+uint64_t lapic_test_tools::tsc_ticks_per_second()
+{
+    static uint64_t tsc_ticks_per_second = 0;
+    if (not tsc_ticks_per_second) {
+        int_guard _;
+
+        wait_till_next_second();
+        auto tsc_before{ rdtsc() };
+        wait_till_next_second();
+        tsc_ticks_per_second = rdtsc() - tsc_before;
+    }
+    return tsc_ticks_per_second;
+}
+
 void lapic_test_tools::enable_periodic_timer(uint32_t interrupt_vector, uint32_t period_in_ms)
 {
     constexpr uint32_t LAPIC_DIVISOR{ 1 };
@@ -258,7 +272,49 @@ void lapic_test_tools::software_apic_enable()
     return (read_from_register(LAPIC_SVR) & (SVR_ENABLED_MASK << SVR_ENABLED_SHIFT)) != 0u;
 }
 
-void lapic_test_tools::send_self_ipi(uint8_t vector, dest_sh sh, dest_mode dest, lvt_dlv_mode dlv)
+uint64_t lapic_test_tools::icr_value(uint8_t vector, uint32_t destination, dest_sh sh, dest_mode dest, lvt_dlv_mode dlv, apic_mode mode)
+{
+    uint32_t icr_entry_lo = 0;
+    uint32_t icr_entry_hi = 0;
+
+    icr_entry_lo |= static_cast<uint32_t>(dlv) << ICR_DLV_MODE_SHIFT;
+    icr_entry_lo |= static_cast<uint32_t>(dest) << ICR_DEST_MODE_SHIFT;
+    icr_entry_lo |= level::ASSERT << ICR_LEVEL_SHIFT;
+    icr_entry_lo |= sh << ICR_DEST_SH_SHIFT;
+
+    if (sh == dest_sh::NO_SH) {
+        if (mode == apic_mode::X2APIC) {
+            icr_entry_hi = destination;
+        }
+        else {
+            assert(destination <= LAPIC_ID_MASK);
+            icr_entry_hi |= destination << ICR_DEST_SHIFT;
+        }
+    }
+
+    icr_entry_lo |= vector;
+
+    return (uint64_t(icr_entry_hi) << 32) | icr_entry_lo;
+}
+
+void lapic_test_tools::write_icr(uint64_t icr, apic_mode mode)
+{
+    if (mode == apic_mode::X2APIC) {
+        // Make preceding stores globally visible before the IPI, see write_x2_msr().
+        asm volatile("mfence; lfence" ::: "memory");
+        wrmsr(msr::X2APIC_ICR, icr);
+        return;
+    }
+
+    wait_until_ready_for_ipi();
+
+    write_to_register(LAPIC_ICR_HIGH, static_cast<uint32_t>(icr >> 32));
+    write_to_register(LAPIC_ICR_LOW, static_cast<uint32_t>(icr));
+
+    wait_until_ready_for_ipi();
+}
+
+void lapic_test_tools::send_ipi(uint8_t vector, uint32_t destination, dest_sh sh, dest_mode dest, lvt_dlv_mode dlv, apic_mode mode)
 {
     // Avoid invalid combinations of delivery modes and vectors according to Intel SDM, Vol. 3, 10.6.1.
     // Vector is ignored for NMI and points to start routine for STARTUP.
@@ -269,7 +325,7 @@ void lapic_test_tools::send_self_ipi(uint8_t vector, dest_sh sh, dest_mode dest,
 
         // don't use spurious vector
         [[maybe_unused]] uint8_t spurious_vector{
-            static_cast<uint8_t>(read_from_register(LAPIC_SVR) & SVR_VECTOR_MASK)
+            static_cast<uint8_t>((mode == apic_mode::X2APIC ? rdmsr(msr::X2APIC_SVR) : read_from_register(LAPIC_SVR)) & SVR_VECTOR_MASK)
         };
         assert(vector != spurious_vector);
     }
@@ -278,27 +334,13 @@ void lapic_test_tools::send_self_ipi(uint8_t vector, dest_sh sh, dest_mode dest,
         assert(vector == 0);
     }
 
-    wait_until_ready_for_ipi();
-
-    uint32_t icr_entry_lo = 0;
-    uint32_t icr_entry_hi = 0;
-
-    icr_entry_lo |= static_cast<uint32_t>(dlv) << ICR_DLV_MODE_SHIFT;
-    icr_entry_lo |= static_cast<uint32_t>(dest) << ICR_DEST_MODE_SHIFT;
-    icr_entry_lo |= level::ASSERT << ICR_LEVEL_SHIFT;
-    icr_entry_lo |= sh << ICR_DEST_SH_SHIFT;
-
-    if (sh == dest_sh::NO_SH) {
-        uint32_t apic_id = (read_from_register(LAPIC_ID) >> LAPIC_ID_SHIFT) & LAPIC_ID_MASK;
-        icr_entry_hi |= apic_id << ICR_DEST_SHIFT;
-    }
-
-    icr_entry_lo |= vector;
-
-    write_to_register(LAPIC_ICR_HIGH, icr_entry_hi);
-    write_to_register(LAPIC_ICR_LOW, icr_entry_lo);
+    write_icr(icr_value(vector, destination, sh, dest, dlv, mode), mode);
+}
 
-    wait_until_ready_for_ipi();
+void lapic_test_tools::send_self_ipi(uint8_t vector, dest_sh sh, dest_mode dest, lvt_dlv_mode dlv)
+{
+    uint8_t apic_id = (read_from_register(LAPIC_ID) >> LAPIC_ID_SHIFT) & LAPIC_ID_MASK;
+    send_ipi(vector, apic_id, sh, dest, dlv);
 }
 
 bool lapic_test_tools::check_irr(uint8_t vector)
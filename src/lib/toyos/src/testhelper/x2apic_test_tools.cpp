@@ -2,7 +2,7 @@
 //
 // SPDX-License-Identifier: GPL-2.0-or-later
 
-#include "x2apic_test_tools.hpp"
+#include <toyos/testhelper/x2apic_test_tools.hpp>
 
 #include <toyos/testhelper/lapic_test_tools.hpp>
 #include <toyos/x86/x86defs.hpp>
@@ -34,17 +34,25 @@ void tinivisor::default_exit_handler(vmcs::vmcs_t& /*vmcs*/, tinivisor::guest_re
 }
 
 /**
- * \brief Handler for vmcall. Used to disable tinivisor.
+ * \brief Handler for vmcall. Used for hypercalls, most notably to disable tinivisor.
  *
  * Like other exit handlers, this function is called by the low level entry point
  * after guest arch state has been saved to a predefined location.
  * Hence, the host's exit handler stack is currently in use.
+ *
+ * A NOP hypercall simply returns to the guest.
+ *
  * When disabling tinivisor, control is returned to the caller of tinivisor::stop.
  * The low level function called here switches to the guest stack and restores the register state.
  * It then jumps to disable_vmx and does not return.
  */
-[[noreturn]] void handle_vmcall(vmcs::vmcs_t& vmcs, tinivisor::guest_regs& regs, x86::vmx_exit_reason /*reason*/, uint64_t /*exit_qual*/)
+void handle_vmcall(vmcs::vmcs_t& vmcs, tinivisor::guest_regs& regs, x86::vmx_exit_reason /*reason*/, uint64_t /*exit_qual*/)
 {
+    if (regs.rax == to_underlying(tinivisor::hypercall::NOP)) {
+        vmcs.adjust_rip();
+        return;
+    }
+
     restore_arch_state_and_jump(regs, vmcs.read(encoding::GUEST_RSP));
     __UNREACHED__;
 }
@@ -149,7 +157,7 @@ void tinivisor::stop()
     // vmcall causes an exit. we set up the exit handler for vmcall
     // to continue at handle_vmcall.
     // handle_vmcall restores the register state and jumps to disable_vmx.
-    asm volatile("vmcall; ud2a;");
+    asm volatile("vmcall; ud2a;" ::"a"(to_underlying(hypercall::STOP)));
     // Do not use __builtin_* here, it leads to aggressive optimization
     // and breaks the return path.
 }
@@ -236,7 +244,11 @@ void tinivisor::clone_segments()
     vmcs.write(encoding::HOST_SEL_FS, fs.selector);
     vmcs.write(encoding::HOST_BASE_FS, fs.base);
     vmcs.write(encoding::HOST_SEL_GS, gs.selector);
-    vmcs.write(encoding::HOST_BASE_GS, gs.base);
+
+    // In 64-bit mode, the GS base comes from its MSR and not from the descriptor. It points to the per-CPU area.
+    const uint64_t gs_base{ rdmsr(x86::msr::GS_BASE) };
+    vmcs.write(encoding::GUEST_BASE_GS, gs_base);
+    vmcs.write(encoding::HOST_BASE_GS, gs_base);
     vmcs.write(encoding::HOST_SEL_TR, tr.selector);
     vmcs.write(encoding::HOST_BASE_TR, tr.base);
     vmcs.write(encoding::HOST_BASE_GDTR, gdtr.base);
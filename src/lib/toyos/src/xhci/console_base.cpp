@@ -20,6 +20,14 @@ void xhci_console_base::putc(char c)
     }
 }
 
+void xhci_console_base::write(const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        dbc_dev_.write_byte(data[i]);
+    }
+    dbc_dev_.flush();
+}
+
 void xhci_console_base::putchar(unsigned char c)
 {
     if (active_console) {
@@ -27,8 +35,15 @@ void xhci_console_base::putchar(unsigned char c)
     }
 }
 
+void xhci_console_base::putstr(const char* data, size_t size)
+{
+    if (active_console) {
+        active_console->write(data, size);
+    }
+}
+
 void xhci_console_init(xhci_console_base& cons)
 {
     active_console = &cons;
-    add_printf_backend(xhci_console_base::putchar);
+    add_printf_backend(xhci_console_base::putchar, xhci_console_base::putstr);
 }
@@ -45,10 +45,14 @@ void xhci_debug_device::queue_write_transfer(const std::string& str)
 {
     auto _{ init_mtx_->guard() };
 
-    // Apparently, the debug device can't handle multiple outstanding requests.
-    // Until we find out why this happens or how to improve it, we
-    // block until the current request is done.
-    while (not out_ring_.empty()) {
+    // Each ring entry has its own slot in the output buffer, so we can keep
+    // queueing until the ring is full. Completed transfers are reaped from the
+    // event ring while we wait. Some debug devices can't handle multiple
+    // outstanding requests, for those we block until the current request is
+    // done.
+    auto busy{ [this] { return transfer_mode_ == transfer_mode::SINGLE_OUTSTANDING ? not out_ring_.empty() : out_ring_.full(); } };
+
+    while (busy()) {
         // Help with the event loop to minimize latency
         if (not handle_events()) {
             // Drop request if connection was lost
@@ -0,0 +1,207 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/statistics.hpp>
+#include <toyos/util/lock_free_queue_def.h>
+#include <toyos/util/math.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+// Cache lines are bounced between vCPUs to show what cache coherence costs inside the VM. Pairs of vCPUs that are
+// SMT siblings should be much faster than pairs on different cores, and pairs on different sockets much slower.
+// If the numbers do not match the topology the guest sees, the vCPUs are not pinned the way the guest is told.
+
+static constexpr unsigned PING_PONG_ROUNDS{ 10000 };
+static constexpr unsigned CONTENTION_OPS{ 100000 };
+
+/// Counters that share one cache line, so every CPU uses a counter of its own.
+static constexpr size_t COUNTERS_PER_LINE{ LFQ_CACHE_LINE_SIZE / sizeof(uint64_t) };
+
+struct alignas(LFQ_CACHE_LINE_SIZE) padded_counter
+{
+    std::atomic<uint64_t> value;
+};
+
+alignas(LFQ_CACHE_LINE_SIZE) static std::atomic<uint64_t> ball;
+alignas(LFQ_CACHE_LINE_SIZE) static std::atomic<uint64_t> shared_counter;
+alignas(LFQ_CACHE_LINE_SIZE) static std::atomic<uint64_t> packed_counters[COUNTERS_PER_LINE];
+static padded_counter padded_counters[smp::MAX_CPUS];
+
+static_assert(sizeof(packed_counters) == LFQ_CACHE_LINE_SIZE);
+
+/// Round trip of a cache line that two CPUs hand back and forth with compare-and-swap.
+static uint64_t measure_ping_pong(size_t first, size_t second)
+{
+    uint64_t cycles{ 0 };
+    ball = 0;
+
+    smp::run_together({ first, second }, [&cycles](size_t side) {
+        const uint64_t start{ rdtsc() };
+
+        for (uint64_t round = 0; round < PING_PONG_ROUNDS; round++) {
+            uint64_t expected{ 2 * round + side };
+            while (ball.load(std::memory_order_relaxed) != expected or not ball.compare_exchange_weak(expected, expected + 1, std::memory_order_acq_rel)) {
+                expected = 2 * round + side;
+                cpu_pause();
+            }
+        }
+
+        if (side == 0) {
+            cycles = rdtsc() - start;
+        }
+    });
+
+    return cycles / PING_PONG_ROUNDS;
+}
+
+/// Average cycles per fetch-add if all CPUs increment the counter returned by counter_of(cpu) at the same time.
+template<typename COUNTER_FN>
+static uint64_t measure_contention(COUNTER_FN counter_of)
+{
+    std::vector<size_t> cpus;
+    for (size_t cpu = 0; cpu < smp::cpu_count(); cpu++) {
+        cpus.push_back(cpu);
+    }
+
+    std::vector<uint64_t> cycles(cpus.size(), 0);
+    smp::run_together(cpus, [&cycles, &counter_of](size_t cpu) {
+        std::atomic<uint64_t>& counter{ counter_of(cpu) };
+        const uint64_t start{ rdtsc() };
+
+        for (unsigned op = 0; op < CONTENTION_OPS; op++) {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        cycles[cpu] = rdtsc() - start;
+    });
+
+    statistics::data<uint64_t> per_op;
+    for (auto c : cycles) {
+        per_op.push(c / CONTENTION_OPS);
+    }
+    return per_op.avg();
+}
+
+static void print_topology()
+{
+    static constexpr uint32_t LEVEL_TYPE_SMT{ 1 };
+    static constexpr uint32_t LEVEL_TYPE_INVALID{ 0 };
+
+    // Leaf 0x1F supersedes leaf 0xB, but reports the same format.
+    const uint32_t max_leaf{ cpuid(0).eax };
+    const uint32_t leaf{ max_leaf >= 0x1f and cpuid(0x1f).ebx != 0 ? 0x1fu : 0xbu };
+
+    if (max_leaf < 0xb or cpuid(0xb).ebx == 0) {
+        info("CPUID leaf 0xB is not supported, the topology is unknown");
+        return;
+    }
+
+    info("Topology from CPUID leaf {#x}:", leaf);
+
+    for (size_t cpu = 0; cpu < smp::cpu_count(); cpu++) {
+        auto describe{ [leaf] {
+            uint32_t smt_shift{ 0 }, package_shift{ 0 }, x2apic_id{ 0 };
+
+            for (uint32_t sub = 0;; sub++) {
+                const auto level{ cpuid(leaf, sub) };
+                const uint32_t type{ (level.ecx >> 8) & 0xff };
+                if (type == LEVEL_TYPE_INVALID) {
+                    break;
+                }
+
+                const uint32_t shift{ level.eax & 0x1f };
+                if (type == LEVEL_TYPE_SMT) {
+                    smt_shift = shift;
+                }
+                package_shift = shift;
+                x2apic_id = level.edx;
+            }
+
+            const uint32_t thread{ x2apic_id & static_cast<uint32_t>(math::mask(smt_shift)) };
+            const uint32_t core{ (x2apic_id & static_cast<uint32_t>(math::mask(package_shift))) >> smt_shift };
+            const uint32_t package{ x2apic_id >> package_shift };
+            return std::string("x2APIC ID ") + std::to_string(x2apic_id) + ", package " + std::to_string(package) + ", core " + std::to_string(core) + ", thread "
+                   + std::to_string(thread);
+        } };
+
+        const std::string description{ cpu == 0 ? describe() : smp::run_on(cpu, describe) };
+        info("  CPU {}: {s}", cpu, description.c_str());
+    }
+}
+
+static void print_matrix(const char* title, const std::vector<std::vector<uint64_t>>& matrix)
+{
+    static constexpr size_t COLUMN_WIDTH{ 8 };
+    auto pad{ [](const std::string& s) { return std::string(COLUMN_WIDTH - std::min(COLUMN_WIDTH, s.size()), ' ') + s; } };
+
+    info("{s} [cycles, rows: first CPU, columns: second CPU]", title);
+
+    std::string header{ pad("") };
+    for (size_t dst = 0; dst < matrix.size(); dst++) {
+        header += pad(std::to_string(dst));
+    }
+    info("{s}", header.c_str());
+
+    for (size_t src = 0; src < matrix.size(); src++) {
+        std::string row{ pad(std::to_string(src)) };
+        for (size_t dst = 0; dst < matrix.size(); dst++) {
+            row += pad(src == dst ? "-" : std::to_string(matrix[src][dst]));
+        }
+        info("{s}", row.c_str());
+    }
+}
+
+void prologue()
+{
+    smp::init();
+}
+
+TEST_CASE_CONDITIONAL(benchmark_cache_line_ping_pong, smp::cpu_count() > 1)
+{
+    const size_t cpus{ smp::cpu_count() };
+    std::vector<std::vector<uint64_t>> round_trips(cpus, std::vector<uint64_t>(cpus, 0));
+    uint64_t sum{ 0 }, best{ ~0ull }, worst{ 0 };
+
+    print_topology();
+
+    for (size_t first = 0; first < cpus; first++) {
+        for (size_t second = first + 1; second < cpus; second++) {
+            const uint64_t round_trip{ measure_ping_pong(first, second) };
+            round_trips[first][second] = round_trips[second][first] = round_trip;
+
+            sum += round_trip;
+            best = std::min(best, round_trip);
+            worst = std::max(worst, round_trip);
+        }
+    }
+
+    print_matrix("CAS ping-pong round trip", round_trips);
+
+    BENCHMARK_RESULT("cache_line_ping_pong_avg", sum / (cpus * (cpus - 1) / 2), "cycles");
+    BENCHMARK_RESULT("cache_line_ping_pong_best_pair", best, "cycles");
+    BENCHMARK_RESULT("cache_line_ping_pong_worst_pair", worst, "cycles");
+}
+
+TEST_CASE_CONDITIONAL(benchmark_fetch_add_contention, smp::cpu_count() > 1)
+{
+    const uint64_t true_sharing{ measure_contention([](size_t) -> std::atomic<uint64_t>& { return shared_counter; }) };
+
+    // With more CPUs than counters in a line, some CPUs share a counter as well.
+    const uint64_t false_sharing{ measure_contention([](size_t cpu) -> std::atomic<uint64_t>& { return packed_counters[cpu % COUNTERS_PER_LINE]; }) };
+    const uint64_t no_sharing{ measure_contention([](size_t cpu) -> std::atomic<uint64_t>& { return padded_counters[cpu].value; }) };
+
+    info("fetch-add on {} CPUs: true sharing {} cycles, false sharing {} cycles, no sharing {} cycles", smp::cpu_count(), true_sharing, false_sharing, no_sharing);
+
+    BENCHMARK_RESULT("fetch_add_true_sharing", true_sharing, "cycles");
+    BENCHMARK_RESULT("fetch_add_false_sharing", false_sharing, "cycles");
+    BENCHMARK_RESULT("fetch_add_no_sharing", no_sharing, "cycles");
+}
+
+BARETEST_RUN;
@@ -2,10 +2,14 @@
 //
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include <toyos/baretest/baretest.hpp>
 #include <toyos/testhelper/statistics.hpp>
+#include <toyos/util/cpuid.hpp>
+#include <toyos/x86/cpuid.hpp>
 #include <toyos/x86/x86asm.hpp>
 
 TEST_CASE(benchmark_cycles)
@@ -19,3 +23,142 @@ TEST_CASE(benchmark_cycles)
 
     BENCHMARK_RESULT("cpuid_cycles", data.avg(), "cycles");
 }
+
+namespace
+{
+
+    // Upper bound for subleaves of a single leaf. Guards against bogus enumeration data.
+    constexpr uint32_t MAX_SUBLEAVES{ 64 };
+
+    /// Append the subleaves whose bits are set in mask, starting at bit first.
+    void append_set_bits(std::vector<uint32_t>& subleaves, uint64_t mask, uint32_t first)
+    {
+        for (uint32_t bit{ first }; bit < MAX_SUBLEAVES; ++bit) {
+            if (mask & (1ull << bit)) {
+                subleaves.push_back(bit);
+            }
+        }
+    }
+
+    /**
+     * Enumerate the valid subleaves of a CPUID leaf.
+     *
+     * Most leaves ignore ECX, they are only measured with subleaf 0. For the
+     * leaves that take a subleaf, the enumeration rules of the SDM/APM are
+     * followed.
+     */
+    std::vector<uint32_t> subleaves_of(uint32_t leaf)
+    {
+        std::vector<uint32_t> subleaves{ 0 };
+        auto sub0{ cpuid(leaf, 0) };
+
+        switch (leaf) {
+            // Deterministic cache parameters: enumerate until the cache type is null.
+            case CPUID_LEAF_CACHE_PARAMETERS:
+            case 0x8000001d:
+                for (uint32_t sub{ 1 }; sub < MAX_SUBLEAVES and (cpuid(leaf, sub).eax & 0x1f) != 0; ++sub) {
+                    subleaves.push_back(sub);
+                }
+                break;
+
+            // Topology: enumerate until the level type is invalid.
+            case CPUID_LEAF_EXTENDED_TOPOLOGY:
+            case CPUID_LEAF_V2_EXTENDED_TOPOLOGY:
+                for (uint32_t sub{ 1 }; sub < MAX_SUBLEAVES and (cpuid(leaf, sub).ecx & 0xff00) != 0; ++sub) {
+                    subleaves.push_back(sub);
+                }
+                break;
+
+            // EAX of subleaf 0 reports the maximum subleaf.
+            case CPUID_LEAF_EXTENDED_FEATURES:
+            case 0x14:  // Intel Processor Trace
+            case 0x17:  // SoC vendor attributes
+            case 0x18:  // Deterministic address translation parameters
+            case 0x1d:  // Tile information
+            case 0x20:  // HRESET
+                for (uint32_t sub{ 1 }; sub <= sub0.eax and sub < MAX_SUBLEAVES; ++sub) {
+                    subleaves.push_back(sub);
+                }
+                break;
+
+            // Extended state: subleaf 1 plus one subleaf per supported XCR0/XSS component.
+            case CPUID_LEAF_EXTENDED_STATE: {
+                auto sub1{ cpuid(leaf, CPUID_EXTENDED_STATE_SUB) };
+                uint64_t components{ (uint64_t(sub0.edx) << 32) | sub0.eax | (uint64_t(sub1.edx) << 32) | sub1.ecx };
+                subleaves.push_back(CPUID_EXTENDED_STATE_SUB);
+                append_set_bits(subleaves, components, 2);
+                break;
+            }
+
+            // RDT monitoring and allocation: EDX resp. EBX of subleaf 0 are resource bitmaps.
+            case 0x0f:
+                append_set_bits(subleaves, sub0.edx, 1);
+                break;
+            case 0x10:
+                append_set_bits(subleaves, sub0.ebx, 1);
+                break;
+
+            // SGX: subleaf 1 plus EPC sections until an invalid one is reported.
+            case CPUID_LEAF_SGX_CAPABILITY:
+                subleaves.push_back(1);
+                for (uint32_t sub{ 2 }; sub < MAX_SUBLEAVES and (cpuid(leaf, sub).eax & 0xf) != 0; ++sub) {
+                    subleaves.push_back(sub);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        return subleaves;
+    }
+
+    /**
+     * Measure all leaves and subleaves from base up to and including max.
+     *
+     * \return the highest average latency of all measured leaves
+     */
+    uint64_t sweep_leaf_range(uint32_t base, uint32_t max)
+    {
+        const unsigned REPETITIONS{ 1000 };
+        const unsigned WARM_UP_ROUNDS{ 100 };
+
+        uint64_t slowest{ 0 };
+
+        for (uint32_t leaf{ base }; leaf <= max; ++leaf) {
+            for (auto subleaf : subleaves_of(leaf)) {
+                auto data{ statistics::measure_cycles([leaf, subleaf]() { cpuid(leaf, subleaf); }, REPETITIONS, WARM_UP_ROUNDS) };
+
+                info("{#08x} {#08x} {8} {8} {8}", leaf, subleaf, data.avg(), data.min(), data.max());
+                slowest = std::max(slowest, data.avg());
+            }
+        }
+
+        return slowest;
+    }
+
+}  // namespace
+
+TEST_CASE(benchmark_cycles_per_leaf)
+{
+    auto max_basic{ cpuid(CPUID_LEAF_MAX_LEVEL_VENDOR_ID).eax };
+    auto max_extended{ cpuid(CPUID_LEAF_EXTENDED_MAX_LEVEL).eax };
+
+    info("leaf       subleaf         avg      min      max");
+
+    uint64_t slowest{ sweep_leaf_range(CPUID_LEAF_MAX_LEVEL_VENDOR_ID, max_basic) };
+
+    // Without a hypervisor, the hypervisor range aliases the highest basic leaf.
+    if (util::cpuid::hv_bit_present()) {
+        auto max_hv{ cpuid(CPUID_LEAF_HYPERVISOR_BASE).eax };
+        if (max_hv >= CPUID_LEAF_HYPERVISOR_BASE and max_hv < CPUID_LEAF_HYPERVISOR_BASE + 0x100) {
+            slowest = std::max(slowest, sweep_leaf_range(CPUID_LEAF_HYPERVISOR_BASE, max_hv));
+        }
+    }
+
+    if (max_extended >= CPUID_LEAF_EXTENDED_MAX_LEVEL and max_extended < CPUID_LEAF_EXTENDED_MAX_LEVEL + 0x100) {
+        slowest = std::max(slowest, sweep_leaf_range(CPUID_LEAF_EXTENDED_MAX_LEVEL, max_extended));
+    }
+
+    BENCHMARK_RESULT("cpuid_slowest_leaf_cycles", slowest, "cycles");
+}
@@ -0,0 +1,119 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/printf/compiled.hpp>
+#include <toyos/testhelper/output_capture.hpp>
+#include <toyos/util/trace.hpp>
+
+/// Use a printf format string as it is, without the pprintpp translation of pprintf_compiled().
+template<typename STRPROV>
+struct raw_format
+{
+    static constexpr const char* value{ STRPROV::str() };
+};
+
+/// Pass enums through varargs as their promoted underlying type, as the compiled format prints them.
+template<typename T>
+static decltype(auto) vararg(const T& value)
+{
+    if constexpr (std::is_enum_v<T>) {
+        return +static_cast<std::underlying_type_t<T>>(value);
+    }
+    else {
+        return (value);
+    }
+}
+
+/// Check that the compiled format prints the same as snprintf() does with the same format string.
+template<typename FORMAT, typename... ARGS>
+static bool prints_like_snprintf(const ARGS&... args)
+{
+    char expected[256];
+    snprintf(expected, sizeof(expected), FORMAT::value, vararg(args)...);
+
+    std::string output;
+    {
+        output_capture capture;
+        compiled_format::print<FORMAT>(args...);
+        output = capture.output();
+    }
+
+    if (output != expected) {
+        info("Format \"{s}\": expected \"{s}\", got \"{s}\"", FORMAT::value, expected, output.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The format string must not end up in the message of BARETEST_ASSERT(), which is a format string itself.
+#define ASSERT_PRINTS_LIKE_SNPRINTF(fmtstr, ...)                                          \
+    do {                                                                                  \
+        struct strprov                                                                    \
+        {                                                                                 \
+            static constexpr const char* str()                                            \
+            {                                                                             \
+                return fmtstr "\n";                                                       \
+            }                                                                             \
+        };                                                                                \
+        const bool same_output{ prints_like_snprintf<raw_format<strprov>>(__VA_ARGS__) }; \
+        BARETEST_ASSERT(same_output);                                                     \
+    } while (0)
+
+enum class small_enum : uint8_t
+{
+    VALUE = 200,
+};
+
+TEST_CASE(compiled_format_prints_literals_and_percent_signs)
+{
+    ASSERT_PRINTS_LIKE_SNPRINTF("just text");
+    ASSERT_PRINTS_LIKE_SNPRINTF("100%% done");
+    ASSERT_PRINTS_LIKE_SNPRINTF("%d%% of %u%%", 5, 10u);
+    ASSERT_PRINTS_LIKE_SNPRINTF("unknown %y conversion %d", 1);
+}
+
+TEST_CASE(compiled_format_pads_like_snprintf)
+{
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%5d] [%-5d] [%05u] [%1d]", 42, 42, 42u, 12345);
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%8s] [%-8s] [%2s] [%s]", "ab", "cd", "long string", "");
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%016b] [%o] [%08lX]", 0x550fu, 8u, 0x123abcul);
+}
+
+TEST_CASE(compiled_format_prints_prefixes_like_snprintf)
+{
+    ASSERT_PRINTS_LIKE_SNPRINTF("%#x %#X %#010x %#-8x|", 0xabcu, 0xabcu, 0xabcu, 0xabcu);
+    ASSERT_PRINTS_LIKE_SNPRINTF("%#lx %#s %#%", 0xfeedul, "str");
+}
+
+TEST_CASE(compiled_format_prints_negative_numbers_like_snprintf)
+{
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%d] [%05d] [%5d] [%-5d]", -42, -42, -42, -42);
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%ld] [%lld] [%d]", -1l, std::numeric_limits<long long>::min(), std::numeric_limits<int>::min());
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%d] [%u] [%x]", int8_t(-1), uint8_t(255), uint16_t(0xffff));
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%u] [%x]", -1, -1);
+}
+
+TEST_CASE(compiled_format_prints_characters_like_snprintf)
+{
+    ASSERT_PRINTS_LIKE_SNPRINTF("%c%c%c", 'a', 'b', 'c');
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%c]", 0x41);
+}
+
+TEST_CASE(compiled_format_prints_pointers_like_snprintf)
+{
+    const int local{ 0 };
+    ASSERT_PRINTS_LIKE_SNPRINTF("%p", &local);
+    ASSERT_PRINTS_LIKE_SNPRINTF("[%p] [%20p]", reinterpret_cast<void*>(0x1234), reinterpret_cast<const char*>(0xffff));
+}
+
+TEST_CASE(compiled_format_prints_enums_like_snprintf)
+{
+    ASSERT_PRINTS_LIKE_SNPRINTF("%u %x", small_enum::VALUE, small_enum::VALUE);
+}
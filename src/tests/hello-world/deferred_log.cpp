@@ -0,0 +1,92 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <setjmp.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/testhelper/output_capture.hpp>
+#include <toyos/util/deferred_log.hpp>
+#include <toyos/util/string.hpp>
+#include <toyos/util/trace.hpp>
+
+/// The messages of the deferred log in the captured output, without their prefix and line ending.
+static std::vector<std::string> deferred_messages(const std::string& output)
+{
+    std::vector<std::string> messages;
+    for (auto line : util::string::split(output, '\n')) {
+        if (line.rfind("[DEF ", 0) != 0) {
+            continue;
+        }
+        if (not line.empty() and line.back() == '\r') {
+            line.pop_back();
+        }
+        messages.push_back(line.substr(line.find("] ") + 2));
+    }
+    return messages;
+}
+
+TEST_CASE(deferred_messages_are_printed_on_drain)
+{
+    output_capture capture;
+
+    deferred_info("string {s} and numbers {} {} {#x}", "argument", 42u, -7, 0xcafeu);
+    deferred_info("character {c}", 'x');
+    BARETEST_ASSERT(deferred_messages(capture.output()).empty());
+
+    deferred_log::drain();
+
+    const auto messages{ deferred_messages(capture.output()) };
+    BARETEST_ASSERT(messages.size() == 2);
+    BARETEST_ASSERT(messages[0] == "string argument and numbers 42 -7 0xcafe");
+    BARETEST_ASSERT(messages[1] == "character x");
+    BARETEST_ASSERT(capture.output().find("[DEF deferred_log.cpp:") != std::string::npos);
+
+    // Drained messages are gone.
+    capture.clear();
+    deferred_log::drain();
+    BARETEST_ASSERT(deferred_messages(capture.output()).empty());
+}
+
+TEST_CASE(oldest_deferred_messages_are_overwritten)
+{
+    static constexpr size_t OVERWRITTEN{ 10 };
+    output_capture capture;
+
+    for (size_t i = 0; i < deferred_log::CAPACITY + OVERWRITTEN; i++) {
+        deferred_info("message {}", i);
+    }
+    deferred_log::drain();
+
+    const auto messages{ deferred_messages(capture.output()) };
+    BARETEST_ASSERT(messages.size() == deferred_log::CAPACITY);
+    BARETEST_ASSERT(messages.front() == "message " + std::to_string(OVERWRITTEN));
+    BARETEST_ASSERT(messages.back() == "message " + std::to_string(deferred_log::CAPACITY + OVERWRITTEN - 1));
+}
+
+TEST_CASE(deferred_messages_survive_a_failed_assertion)
+{
+    output_capture capture;
+
+    // Fail an assertion like a test case does, but catch it here instead of failing this test case.
+    jmp_buf test_case_env;
+    memcpy(test_case_env, baretest::get_env(), sizeof(jmp_buf));
+
+    info("The next assertion fails on purpose");
+    if (setjmp(baretest::get_env()) == 0) {
+        deferred_info("before the failure {s} {}", "with", 1);
+        BARETEST_ASSERT(false);
+    }
+    memcpy(baretest::get_env(), test_case_env, sizeof(jmp_buf));
+
+    // This is what baretest does after a failed test case.
+    deferred_log::drain();
+
+    const auto messages{ deferred_messages(capture.output()) };
+    BARETEST_ASSERT(messages.size() == 1);
+    BARETEST_ASSERT(messages[0] == "before the failure with 1");
+}
@@ -0,0 +1,433 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/irq_handler.hpp>
+#include <toyos/testhelper/lapic_test_tools.hpp>
+#include <toyos/testhelper/statistics.hpp>
+#include <toyos/testhelper/x2apic_test_tools.hpp>
+#include <toyos/x86/x86asm.hpp>
+#include <toyos/x86/x86defs.hpp>
+
+using namespace lapic_test_tools;
+
+// IPIs are sent between all pairs of CPUs. The receiving CPU spins with interrupts enabled, so the measured
+// latency is the cost of the IPI path in the VMM (ICR write exit or IPI virtualization, posted interrupt delivery)
+// and not the wake-up latency of a halted vCPU.
+//
+// One-way latencies compare TSC values of different CPUs and thus assume synchronized TSCs. Ping-pong latencies
+// are measured on the sending CPU only.
+
+static constexpr unsigned ROUNDS{ 500 };
+static constexpr unsigned WARM_UP_ROUNDS{ 50 };
+
+/// Every CPU receives unicast IPIs on its own vector, so the handler knows the receiving CPU without exiting.
+static constexpr uint8_t UNICAST_VECTOR_BASE{ 0x40 };
+static constexpr uint8_t MULTICAST_VECTOR{ 0xf0 };
+
+static_assert(UNICAST_VECTOR_BASE + smp::MAX_CPUS <= MULTICAST_VECTOR);
+
+struct alignas(CPU_CACHE_LINE_SIZE) ipi_state
+{
+    std::atomic<uint64_t> received{ 0 };
+
+    /// TSC value when the last IPI arrived.
+    std::atomic<uint64_t> arrival{ 0 };
+
+    /// ICR value of an IPI that is sent back from the handler, zero for none.
+    std::atomic<uint64_t> reply_icr{ 0 };
+
+    /// Logical APIC ID from the LDR.
+    uint32_t logical_id{ 0 };
+};
+
+static ipi_state ipi_states[smp::MAX_CPUS];
+static apic_mode current_mode{ apic_mode::XAPIC };
+
+static std::atomic<size_t> receivers_ready{ 0 };
+static std::atomic<bool> stop_receiving{ false };
+
+static uint8_t unicast_vector(size_t cpu)
+{
+    return static_cast<uint8_t>(UNICAST_VECTOR_BASE + cpu);
+}
+
+static void eoi()
+{
+    if (current_mode == apic_mode::X2APIC) {
+        wrmsr(x86::msr::X2APIC_EOI, 0);
+    }
+    else {
+        send_eoi();
+    }
+}
+
+static void ipi_handler(intr_regs* regs)
+{
+    const uint64_t now{ rdtsc() };
+
+    PANIC_UNLESS(regs->vector == MULTICAST_VECTOR or (regs->vector >= UNICAST_VECTOR_BASE and regs->vector < UNICAST_VECTOR_BASE + smp::cpu_count()),
+                 "Unexpected vector {}", regs->vector);
+
+    const size_t cpu{ regs->vector == MULTICAST_VECTOR ? smp::current_cpu() : regs->vector - UNICAST_VECTOR_BASE };
+    auto& state{ ipi_states[cpu] };
+
+    state.arrival.store(now, std::memory_order_relaxed);
+    eoi();
+
+    const uint64_t reply{ state.reply_icr.load(std::memory_order_relaxed) };
+    if (reply) {
+        write_icr(reply, current_mode);
+    }
+
+    state.received.fetch_add(1, std::memory_order_release);
+}
+
+/// Run a function on any CPU, including the BSP.
+static void run_on_cpu(size_t cpu, const std::function<void()>& fn)
+{
+    if (cpu == 0) {
+        fn();
+    }
+    else {
+        smp::run_on(cpu, fn);
+    }
+}
+
+/// Take part in a measurement as receiver until stop_receiving is set.
+static void receive_until_stopped()
+{
+    enable_interrupts();
+    receivers_ready++;
+
+    while (not stop_receiving.load(std::memory_order_acquire)) {
+        cpu_pause();
+    }
+
+    disable_interrupts();
+}
+
+/**
+ * Let all receivers wait for IPIs and execute the sender function on another CPU. Returns once the sender
+ * function returned.
+ */
+static void with_receivers(const std::vector<size_t>& receivers, size_t sender, const std::function<void()>& send_fn)
+{
+    receivers_ready = 0;
+    stop_receiving = false;
+
+    const std::function<void()> receiver{ receive_until_stopped };
+    const std::function<void()> sender_fn{ [&send_fn, &receivers] {
+        while (receivers_ready.load() < receivers.size()) {
+            cpu_pause();
+        }
+        send_fn();
+        stop_receiving.store(true, std::memory_order_release);
+    } };
+
+    bool bsp_receives{ false };
+    for (auto cpu : receivers) {
+        if (cpu == 0) {
+            bsp_receives = true;
+        }
+        else {
+            smp::start_on(cpu, receiver);
+        }
+    }
+
+    if (sender == 0) {
+        sender_fn();
+    }
+    else {
+        smp::start_on(sender, sender_fn);
+        if (bsp_receives) {
+            receive_until_stopped();
+        }
+        smp::wait_for(sender);
+    }
+
+    for (auto cpu : receivers) {
+        if (cpu != 0) {
+            smp::wait_for(cpu);
+        }
+    }
+}
+
+static void wait_for_change(const std::atomic<uint64_t>& counter, uint64_t old)
+{
+    while (counter.load(std::memory_order_acquire) == old) {
+        cpu_pause();
+    }
+}
+
+/// Latency from sending until the handler on the receiving CPU runs.
+static uint64_t measure_one_way(uint64_t icr, size_t receiver)
+{
+    auto& rx{ ipi_states[receiver] };
+    statistics::data<uint64_t> latencies;
+
+    for (unsigned round = 0; round < WARM_UP_ROUNDS + ROUNDS; round++) {
+        const uint64_t before{ rx.received.load(std::memory_order_acquire) };
+        const uint64_t start{ rdtsc() };
+        write_icr(icr, current_mode);
+        wait_for_change(rx.received, before);
+
+        const uint64_t arrival{ rx.arrival.load(std::memory_order_relaxed) };
+        if (round >= WARM_UP_ROUNDS) {
+            latencies.push(arrival > start ? arrival - start : 0);
+        }
+    }
+
+    return latencies.avg();
+}
+
+/// Round trip of an IPI to the receiver, whose handler immediately sends an IPI back.
+static uint64_t measure_ping_pong(uint64_t icr, size_t sender, size_t receiver)
+{
+    auto& tx{ ipi_states[sender] };
+    auto& rx{ ipi_states[receiver] };
+    statistics::data<uint64_t> latencies;
+
+    rx.reply_icr = icr_value(unicast_vector(sender), smp::apic_id(sender), dest_sh::NO_SH, dest_mode::PHYSICAL, lvt_dlv_mode::FIXED, current_mode);
+    enable_interrupts();
+
+    for (unsigned round = 0; round < WARM_UP_ROUNDS + ROUNDS; round++) {
+        const uint64_t before{ tx.received.load(std::memory_order_acquire) };
+        const uint64_t start{ rdtsc() };
+        write_icr(icr, current_mode);
+        wait_for_change(tx.received, before);
+        const uint64_t end{ rdtsc() };
+
+        if (round >= WARM_UP_ROUNDS) {
+            latencies.push(end - start);
+        }
+    }
+
+    disable_interrupts();
+    rx.reply_icr = 0;
+
+    return latencies.avg();
+}
+
+/// Latency from sending until the handlers on all receivers ran, as observed by the sender.
+static uint64_t measure_multicast(uint64_t icr, const std::vector<size_t>& receivers)
+{
+    statistics::data<uint64_t> latencies;
+    std::vector<uint64_t> before(receivers.size());
+
+    for (unsigned round = 0; round < WARM_UP_ROUNDS + ROUNDS; round++) {
+        for (size_t i = 0; i < receivers.size(); i++) {
+            before[i] = ipi_states[receivers[i]].received.load(std::memory_order_acquire);
+        }
+
+        const uint64_t start{ rdtsc() };
+        write_icr(icr, current_mode);
+        for (size_t i = 0; i < receivers.size(); i++) {
+            wait_for_change(ipi_states[receivers[i]].received, before[i]);
+        }
+        const uint64_t end{ rdtsc() };
+
+        if (round >= WARM_UP_ROUNDS) {
+            latencies.push(end - start);
+        }
+    }
+
+    return latencies.avg();
+}
+
+static void print_matrix(const char* title, const std::vector<std::vector<uint64_t>>& matrix)
+{
+    static constexpr size_t COLUMN_WIDTH{ 8 };
+    auto pad{ [](const std::string& s) { return std::string(COLUMN_WIDTH - std::min(COLUMN_WIDTH, s.size()), ' ') + s; } };
+
+    info("{s} [cycles, rows: source, columns: destination]", title);
+
+    std::string header{ pad("") };
+    for (size_t dst = 0; dst < matrix.size(); dst++) {
+        header += pad(std::to_string(dst));
+    }
+    info("{s}", header.c_str());
+
+    for (size_t src = 0; src < matrix.size(); src++) {
+        std::string row{ pad(std::to_string(src)) };
+        for (size_t dst = 0; dst < matrix.size(); dst++) {
+            row += pad(src == dst ? "-" : std::to_string(matrix[src][dst]));
+        }
+        info("{s}", row.c_str());
+    }
+}
+
+/// Report the average over all pairs and the slowest pair of a latency matrix.
+static void report_matrix(const std::string& name, const std::vector<std::vector<uint64_t>>& matrix)
+{
+    uint64_t sum{ 0 }, worst{ 0 };
+    const size_t pairs{ matrix.size() * (matrix.size() - 1) };
+
+    for (size_t src = 0; src < matrix.size(); src++) {
+        for (size_t dst = 0; dst < matrix.size(); dst++) {
+            if (src != dst) {
+                sum += matrix[src][dst];
+                worst = std::max(worst, matrix[src][dst]);
+            }
+        }
+    }
+
+    BENCHMARK_RESULT((name + "_avg").c_str(), sum / pairs, "cycles");
+    BENCHMARK_RESULT((name + "_worst_pair").c_str(), worst, "cycles");
+}
+
+/// Bring the LAPICs of all CPUs into the given mode and program logical destinations.
+static void setup_lapics(apic_mode mode)
+{
+    current_mode = mode;
+
+    for (size_t cpu = 0; cpu < smp::cpu_count(); cpu++) {
+        run_on_cpu(cpu, [mode, cpu] {
+            if (mode == apic_mode::X2APIC) {
+                x2apic_test_tools::x2apic_mode_enable();
+                wrmsr(x86::msr::X2APIC_SVR, rdmsr(x86::msr::X2APIC_SVR) | (SVR_ENABLED_MASK << SVR_ENABLED_SHIFT));
+
+                // The logical ID is fixed in x2APIC mode.
+                ipi_states[cpu].logical_id = static_cast<uint32_t>(rdmsr(x86::msr::X2APIC_LDR));
+            }
+            else {
+                software_apic_enable();
+
+                // Flat model, which supports up to 8 CPUs with one bit each.
+                write_to_register(LAPIC_DFR, ~0u);
+                ipi_states[cpu].logical_id = cpu < 8 ? 1u << cpu : 0;
+                write_to_register(LAPIC_LDR, ipi_states[cpu].logical_id << LAPIC_ID_SHIFT);
+            }
+        });
+    }
+}
+
+static void restore_lapics()
+{
+    if (current_mode == apic_mode::X2APIC) {
+        for (size_t cpu = 0; cpu < smp::cpu_count(); cpu++) {
+            run_on_cpu(cpu, x2apic_test_tools::x2apic_mode_disable);
+        }
+    }
+    current_mode = apic_mode::XAPIC;
+}
+
+/**
+ * Logical destination that addresses all given CPUs with one IPI. In x2APIC cluster mode, only CPUs in the cluster
+ * of the first CPU can be addressed together, so the others are removed from the list.
+ */
+static uint32_t multicast_destination(std::vector<size_t>& cpus)
+{
+    static constexpr uint32_t X2APIC_CLUSTER_SHIFT{ 16 };
+
+    uint32_t destination{ 0 };
+    const uint32_t cluster{ ipi_states[cpus.front()].logical_id >> X2APIC_CLUSTER_SHIFT };
+
+    auto unreachable{ [cluster](size_t cpu) {
+        const uint32_t id{ ipi_states[cpu].logical_id };
+        return id == 0 or (current_mode == apic_mode::X2APIC and (id >> X2APIC_CLUSTER_SHIFT) != cluster);
+    } };
+    cpus.erase(std::remove_if(cpus.begin(), cpus.end(), unreachable), cpus.end());
+
+    for (auto cpu : cpus) {
+        destination |= ipi_states[cpu].logical_id;
+    }
+    return destination;
+}
+
+static void benchmark_ipis(const std::string& prefix)
+{
+    const size_t cpus{ smp::cpu_count() };
+    std::vector<std::vector<uint64_t>> one_way(cpus, std::vector<uint64_t>(cpus, 0));
+    std::vector<std::vector<uint64_t>> ping_pong(cpus, std::vector<uint64_t>(cpus, 0));
+
+    irq_handler::guard _{ ipi_handler };
+
+    for (size_t src = 0; src < cpus; src++) {
+        for (size_t dst = 0; dst < cpus; dst++) {
+            if (src == dst) {
+                continue;
+            }
+
+            const uint64_t icr{ icr_value(unicast_vector(dst), smp::apic_id(dst), dest_sh::NO_SH, dest_mode::PHYSICAL, lvt_dlv_mode::FIXED, current_mode) };
+            with_receivers({ dst }, src, [&] {
+                one_way[src][dst] = measure_one_way(icr, dst);
+                ping_pong[src][dst] = measure_ping_pong(icr, src, dst);
+            });
+        }
+    }
+
+    print_matrix((prefix + " one-way").c_str(), one_way);
+    print_matrix((prefix + " ping-pong").c_str(), ping_pong);
+    report_matrix("ipi_" + prefix + "_one_way", one_way);
+    report_matrix("ipi_" + prefix + "_ping_pong", ping_pong);
+
+    std::vector<size_t> aps;
+    for (size_t cpu = 1; cpu < cpus; cpu++) {
+        aps.push_back(cpu);
+    }
+
+    // Broadcast to all other CPUs via shorthand.
+    const uint64_t broadcast_icr{ icr_value(MULTICAST_VECTOR, 0, dest_sh::ALL_EXC_SELF, dest_mode::PHYSICAL, lvt_dlv_mode::FIXED, current_mode) };
+    uint64_t broadcast{ 0 };
+    with_receivers(aps, 0, [&] { broadcast = measure_multicast(broadcast_icr, aps); });
+
+    info("{s} broadcast to {} CPUs: {} cycles", prefix.c_str(), aps.size(), broadcast);
+    BENCHMARK_RESULT(("ipi_" + prefix + "_broadcast").c_str(), broadcast, "cycles");
+
+    // Logical destination mode, to a single CPU and to as many CPUs as one logical destination can address.
+    statistics::data<uint64_t> logical_latencies;
+    for (auto ap : aps) {
+        if (ipi_states[ap].logical_id == 0) {
+            continue;
+        }
+
+        const uint64_t icr{ icr_value(unicast_vector(ap), ipi_states[ap].logical_id, dest_sh::NO_SH, dest_mode::LOGICAL, lvt_dlv_mode::FIXED, current_mode) };
+        with_receivers({ ap }, 0, [&] { logical_latencies.push(measure_ping_pong(icr, 0, ap)); });
+    }
+
+    if (logical_latencies.has_data()) {
+        info("{s} logical ping-pong: avg {} cycles", prefix.c_str(), logical_latencies.avg());
+        BENCHMARK_RESULT(("ipi_" + prefix + "_logical_ping_pong").c_str(), logical_latencies.avg(), "cycles");
+    }
+
+    std::vector<size_t> group{ aps };
+    const uint32_t group_destination{ multicast_destination(group) };
+    if (not group.empty()) {
+        const uint64_t icr{ icr_value(MULTICAST_VECTOR, group_destination, dest_sh::NO_SH, dest_mode::LOGICAL, lvt_dlv_mode::FIXED, current_mode) };
+        uint64_t multicast{ 0 };
+        with_receivers(group, 0, [&] { multicast = measure_multicast(icr, group); });
+
+        info("{s} logical multicast to {} CPUs: {} cycles", prefix.c_str(), group.size(), multicast);
+        BENCHMARK_RESULT(("ipi_" + prefix + "_logical_multicast").c_str(), multicast, "cycles");
+    }
+}
+
+void prologue()
+{
+    mask_pic();
+    smp::init();
+}
+
+TEST_CASE_CONDITIONAL(benchmark_ipis_xapic, smp::cpu_count() > 1)
+{
+    setup_lapics(apic_mode::XAPIC);
+    benchmark_ipis("xapic");
+    restore_lapics();
+}
+
+TEST_CASE_CONDITIONAL(benchmark_ipis_x2apic, smp::cpu_count() > 1 and x2apic_test_tools::x2apic_mode_supported())
+{
+    setup_lapics(apic_mode::X2APIC);
+    benchmark_ipis("x2apic");
+    restore_lapics();
+}
+
+BARETEST_RUN;
@@ -11,6 +11,7 @@
 #include <toyos/testhelper/irqinfo.hpp>
 #include <toyos/testhelper/lapic_test_tools.hpp>
 #include <toyos/testhelper/pic.hpp>
+#include <toyos/testhelper/x2apic_test_tools.hpp>
 #include <toyos/util/cast_helpers.hpp>
 #include <toyos/util/cpuid.hpp>
 #include <toyos/x86/cpuid.hpp>
@@ -19,8 +20,6 @@
 
 #include <toyos/baretest/baretest.hpp>
 
-#include "x2apic_test_tools.hpp"
-
 using namespace lapic_test_tools;
 using namespace x2apic_test_tools;
 using namespace x86;
@@ -0,0 +1,142 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/irq_handler.hpp>
+#include <toyos/testhelper/lapic_test_tools.hpp>
+#include <toyos/util/spinlock.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+using namespace lapic_test_tools;
+
+// All locks of toyos/util/spinlock.hpp are acquired by 1..N CPUs at the same time. The result is the average time
+// between two acquisitions, i.e. the inverse of the throughput of the lock.
+//
+// The effect of lock-holder preemption only shows when the host preempts vCPUs, e.g. when the VM has more vCPUs than
+// it has physical CPUs available. Under these conditions, the FIFO locks degrade most and pv_spinlock should degrade
+// least.
+
+static constexpr unsigned ACQUISITIONS{ 20000 };
+
+/// Length of the critical section in PAUSE instructions.
+static constexpr unsigned CRITICAL_SECTION_PAUSES{ 10 };
+
+static constexpr uint8_t KICK_VECTOR{ 0x40 };
+
+/// Only modified with the lock held.
+static uint64_t protected_counter;
+
+static void kick_handler(intr_regs* regs)
+{
+    PANIC_UNLESS(regs->vector == KICK_VECTOR, "Unexpected vector {}", regs->vector);
+    send_eoi();
+}
+
+static void kick(size_t cpu)
+{
+    send_ipi(KICK_VECTOR, smp::apic_id(cpu));
+}
+
+/// Cycles per acquisition if the given number of CPUs compete for the lock, or nothing if the lock did not provide
+/// mutual exclusion.
+template<typename LOCK>
+static std::optional<uint64_t> measure_lock(LOCK& lock, size_t cpu_count)
+{
+    std::vector<size_t> cpus;
+    for (size_t cpu = 0; cpu < cpu_count; cpu++) {
+        cpus.push_back(cpu);
+    }
+
+    std::vector<uint64_t> cycles(cpu_count, 0);
+    protected_counter = 0;
+
+    smp::run_together(cpus, [&lock, &cycles](size_t i) {
+        const uint64_t start{ rdtsc() };
+
+        for (unsigned acquisition = 0; acquisition < ACQUISITIONS; acquisition++) {
+            typename LOCK::guard _{ lock };
+
+            protected_counter++;
+            for (unsigned p = 0; p < CRITICAL_SECTION_PAUSES; p++) {
+                cpu_pause();
+            }
+        }
+
+        cycles[i] = rdtsc() - start;
+    });
+
+    if (protected_counter != cpu_count * ACQUISITIONS) {
+        return {};
+    }
+    return *std::max_element(cycles.begin(), cycles.end()) / (cpu_count * ACQUISITIONS);
+}
+
+/// Returns false if the lock did not provide mutual exclusion.
+template<typename LOCK>
+static bool benchmark_lock(LOCK& lock, const std::string& name)
+{
+    for (size_t cpu_count = 1; cpu_count <= smp::cpu_count(); cpu_count++) {
+        const auto cycles{ measure_lock(lock, cpu_count) };
+        if (not cycles) {
+            info("{s} with {} CPUs does not provide mutual exclusion", name.c_str(), cpu_count);
+            return false;
+        }
+
+        info("{s} with {} CPUs: {} cycles per acquisition", name.c_str(), cpu_count, *cycles);
+        BENCHMARK_RESULT(("lock_" + name + "_" + std::to_string(cpu_count) + "_cpus").c_str(), *cycles, "cycles");
+    }
+    return true;
+}
+
+void prologue()
+{
+    mask_pic();
+    smp::init();
+
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        smp::run_on(cpu, software_apic_enable);
+    }
+    software_apic_enable();
+}
+
+TEST_CASE(benchmark_spinlock)
+{
+    spinlock lock;
+    BARETEST_ASSERT(benchmark_lock(lock, "spinlock"));
+}
+
+TEST_CASE(benchmark_ticket_lock)
+{
+    ticket_lock lock;
+    BARETEST_ASSERT(benchmark_lock(lock, "ticket"));
+}
+
+TEST_CASE(benchmark_mcs_lock)
+{
+    mcs_lock lock;
+    BARETEST_ASSERT(benchmark_lock(lock, "mcs"));
+}
+
+TEST_CASE(benchmark_pv_spinlock)
+{
+    bool mutual_exclusion;
+    {
+        irq_handler::guard _{ kick_handler };
+
+        pv_spinlock lock{ kick };
+        mutual_exclusion = benchmark_lock(lock, "pv_spinlock");
+    }
+
+    // A failed assertion does not run destructors, so only check once the handler is restored.
+    BARETEST_ASSERT(mutual_exclusion);
+}
+
+BARETEST_RUN;
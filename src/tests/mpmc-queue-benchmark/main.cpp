@@ -0,0 +1,225 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/util/lock_free_queue.hpp>
+#include <toyos/util/math.hpp>
+#include <toyos/util/mpmc_queue.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+// Producers and consumers on different CPUs move items through one queue. The result is the average time per item
+// from the first push to the last pop. Every item encodes its producer and a sequence number, so consumers can
+// check that no item is lost or duplicated and that the items of each producer arrive in order.
+
+static constexpr size_t QUEUE_SIZE{ 256 };
+static constexpr uint64_t ITEMS_PER_PRODUCER{ 100000 };
+static constexpr size_t BATCH_SIZE{ 16 };
+
+static constexpr unsigned PRODUCER_SHIFT{ 48 };
+
+using queue_t = cbl::static_mpmc_queue<uint64_t, QUEUE_SIZE>;
+
+static uint64_t make_item(size_t producer, uint64_t sequence)
+{
+    return (producer << PRODUCER_SHIFT) | sequence;
+}
+
+/// Tracks the items a consumer has seen. Items of one producer must arrive in order at every consumer.
+struct consumer_state
+{
+    explicit consumer_state(size_t producers)
+        : next_sequence(producers, 0) {}
+
+    bool consume(uint64_t item)
+    {
+        const size_t producer{ item >> PRODUCER_SHIFT };
+        const uint64_t sequence{ item & math::mask(PRODUCER_SHIFT) };
+
+        if (producer >= next_sequence.size() or sequence < next_sequence[producer]) {
+            return false;
+        }
+
+        next_sequence[producer] = sequence + 1;
+        count++;
+        sum += item;
+        return true;
+    }
+
+    std::vector<uint64_t> next_sequence;
+    uint64_t count{ 0 };
+    uint64_t sum{ 0 };
+};
+
+/**
+ * Move all items through the queue with the given number of producers and consumers.
+ * \param batch number of items that are pushed or popped at once
+ * \return cycles per item, or nothing if items were lost, duplicated or reordered
+ */
+static std::optional<uint64_t> measure_queue(size_t producers, size_t consumers, size_t batch)
+{
+    static queue_t queue;
+
+    std::vector<size_t> cpus;
+    for (size_t cpu = 0; cpu < producers + consumers; cpu++) {
+        cpus.push_back(cpu);
+    }
+
+    const uint64_t total{ producers * ITEMS_PER_PRODUCER };
+    std::atomic<uint64_t> consumed{ 0 }, sum{ 0 };
+    std::atomic<bool> ordered{ true };
+    std::vector<uint64_t> start(cpus.size()), end(cpus.size());
+
+    smp::run_together(cpus, [&](size_t i) {
+        start[i] = rdtsc();
+
+        if (i < producers) {
+            std::array<uint64_t, BATCH_SIZE> items;
+            for (uint64_t sequence = 0; sequence < ITEMS_PER_PRODUCER;) {
+                const size_t count{ std::min<size_t>(batch, ITEMS_PER_PRODUCER - sequence) };
+                for (size_t j = 0; j < count; j++) {
+                    items[j] = make_item(i, sequence + j);
+                }
+
+                const size_t pushed{ queue.push(items.data(), count) };
+                sequence += pushed;
+                if (pushed == 0) {
+                    cpu_pause();
+                }
+            }
+        }
+        else {
+            consumer_state state{ producers };
+            std::array<uint64_t, BATCH_SIZE> items;
+
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                const size_t popped{ queue.pop(items.data(), batch) };
+                for (size_t j = 0; j < popped; j++) {
+                    if (not state.consume(items[j])) {
+                        ordered = false;
+                    }
+                }
+
+                if (popped == 0) {
+                    cpu_pause();
+                }
+                consumed += popped;
+            }
+
+            sum += state.sum;
+        }
+
+        end[i] = rdtsc();
+    });
+
+    uint64_t expected_sum{ 0 };
+    for (size_t producer = 0; producer < producers; producer++) {
+        for (uint64_t sequence = 0; sequence < ITEMS_PER_PRODUCER; sequence++) {
+            expected_sum += make_item(producer, sequence);
+        }
+    }
+
+    if (not ordered.load()) {
+        info("Items of a producer arrived out of order");
+        return {};
+    }
+    if (consumed.load() != total or sum.load() != expected_sum) {
+        info("Items were lost or duplicated");
+        return {};
+    }
+    if (not queue.empty()) {
+        info("Queue is not empty after all items were consumed");
+        return {};
+    }
+
+    const uint64_t duration{ *std::max_element(end.begin(), end.end()) - *std::min_element(start.begin(), start.end()) };
+    return duration / total;
+}
+
+/// The single-producer, single-consumer queue as baseline. Returns nothing if items arrived out of order.
+static std::optional<uint64_t> measure_spsc_queue()
+{
+    static cbl::static_lock_free_queue<uint64_t, QUEUE_SIZE> queue;
+
+    uint64_t duration{ 0 };
+    bool ordered{ true };
+
+    smp::run_together({ 0, 1 }, [&](size_t i) {
+        const uint64_t start{ rdtsc() };
+
+        for (uint64_t sequence = 0; sequence < ITEMS_PER_PRODUCER;) {
+            if (i == 0) {
+                sequence += queue.push(sequence) ? 1 : 0;
+                continue;
+            }
+
+            const auto item{ cbl::get_and_pop(queue) };
+            if (item) {
+                ordered = ordered and *item == sequence;
+                sequence++;
+            }
+        }
+
+        if (i == 1) {
+            duration = rdtsc() - start;
+        }
+    });
+
+    if (not ordered) {
+        info("Items arrived out of order");
+        return {};
+    }
+    return duration / ITEMS_PER_PRODUCER;
+}
+
+/// Returns false if the queue lost, duplicated or reordered items.
+static bool benchmark(size_t producers, size_t consumers, size_t batch)
+{
+    const auto cycles{ measure_queue(producers, consumers, batch) };
+    if (not cycles) {
+        return false;
+    }
+
+    const std::string name{ "mpmc_queue_" + std::to_string(producers) + "p" + std::to_string(consumers) + "c" + (batch > 1 ? "_batch" : "") };
+
+    info("{} producers, {} consumers, batches of {}: {} cycles per item", producers, consumers, batch, *cycles);
+    BENCHMARK_RESULT(name.c_str(), *cycles, "cycles");
+    return true;
+}
+
+void prologue()
+{
+    smp::init();
+}
+
+TEST_CASE_CONDITIONAL(benchmark_spsc_baseline, smp::cpu_count() > 1)
+{
+    const auto cycles{ measure_spsc_queue() };
+    BARETEST_ASSERT(cycles.has_value());
+
+    info("SPSC queue: {} cycles per item", *cycles);
+    BENCHMARK_RESULT("spsc_queue_1p1c", *cycles, "cycles");
+}
+
+TEST_CASE_CONDITIONAL(benchmark_single_items, smp::cpu_count() > 1)
+{
+    for (size_t producers = 1; producers < smp::cpu_count(); producers++) {
+        BARETEST_ASSERT(benchmark(producers, smp::cpu_count() - producers, 1));
+    }
+}
+
+TEST_CASE_CONDITIONAL(benchmark_batches, smp::cpu_count() > 1)
+{
+    for (size_t producers = 1; producers < smp::cpu_count(); producers++) {
+        BARETEST_ASSERT(benchmark(producers, smp::cpu_count() - producers, BATCH_SIZE));
+    }
+}
+
+BARETEST_RUN;
@@ -0,0 +1,115 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/testhelper/statistics.hpp>
+#include <toyos/x86/cpuid.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+// Spin loops consisting of PAUSE instructions trigger PAUSE-loop exits (PLE) on the host once the PAUSEs follow
+// each other closely enough (ple_gap) for long enough (ple_window). This benchmark spins with varying loop lengths
+// and PAUSE densities and records the latency of every single loop iteration. An exit shows up as an iteration that
+// takes considerably longer than the fastest one.
+
+/// Number of PAUSE iterations of a single spin loop.
+static constexpr std::array<unsigned, 4> LOOP_LENGTHS{ 64, 1024, 16384, 131072 };
+
+/// Number of empty loop iterations between two PAUSEs. Zero means back-to-back PAUSEs.
+static constexpr std::array<unsigned, 3> PAUSE_DISTANCES{ 0, 64, 1024 };
+
+/// Number of spin loops per configuration.
+static constexpr unsigned SPIN_LOOPS{ 8 };
+
+/// Lower bound for the additional latency of an iteration that is considered an exit.
+static constexpr uint64_t MIN_EXIT_CYCLES{ 500 };
+
+static void filler(unsigned distance)
+{
+    for (unsigned i = 0; i < distance; i++) {
+        // Force the compiler to actually loop, see the timing test.
+        asm volatile("");
+    }
+}
+
+/**
+ * Determine the latency above which an iteration is considered to contain an exit.
+ *
+ * CPUID unconditionally exits when running virtualized, so half of its round trip is a lower bound for the cost
+ * of an exit. On bare metal, CPUID is fast and MIN_EXIT_CYCLES takes over.
+ */
+static uint64_t exit_threshold_cycles()
+{
+    auto cpuid_cycles{ statistics::measure_cycles([] { cpuid(CPUID_LEAF_FAMILY_FEATURES); }, 1000, 100) };
+    return std::max(cpuid_cycles.min() / 2, MIN_EXIT_CYCLES);
+}
+
+/**
+ * Run a single spin loop and record the latency of every iteration.
+ */
+static void spin(unsigned length, unsigned distance, uint64_t threshold, statistics::log2_histogram& histogram,
+                 uint64_t& large_gaps, uint64_t& total, uint64_t& max)
+{
+    uint64_t prev{ rdtsc() };
+
+    for (unsigned i = 0; i < length; i++) {
+        cpu_pause();
+        filler(distance);
+
+        const uint64_t now{ rdtsc() };
+        const uint64_t latency{ now - prev };
+        prev = now;
+
+        histogram.record(latency);
+        total += latency;
+        max = std::max(max, latency);
+        if (latency > threshold) {
+            large_gaps++;
+        }
+    }
+}
+
+TEST_CASE(benchmark_pause_loops)
+{
+    const uint64_t exit_cost{ exit_threshold_cycles() };
+    info("Assuming exits take at least {} cycles", exit_cost);
+
+    for (auto distance : PAUSE_DISTANCES) {
+        // The fastest iteration of a short loop is the baseline. Short loops are not expected to exceed the PLE
+        // window.
+        statistics::log2_histogram ignored;
+        uint64_t baseline{ ~0ul };
+        for (unsigned round = 0; round < 100; round++) {
+            uint64_t large_gaps{ 0 }, total{ 0 }, max{ 0 };
+            spin(1, distance, ~0ul, ignored, large_gaps, total, max);
+            baseline = std::min(baseline, total);
+        }
+
+        const uint64_t threshold{ baseline + exit_cost };
+
+        for (auto length : LOOP_LENGTHS) {
+            statistics::log2_histogram histogram;
+            uint64_t large_gaps{ 0 }, total{ 0 }, max{ 0 };
+
+            for (unsigned loop = 0; loop < SPIN_LOOPS; loop++) {
+                spin(length, distance, threshold, histogram, large_gaps, total, max);
+            }
+
+            const uint64_t avg{ total / histogram.count() };
+
+            info("length {} distance {}: avg {} max {} cycles, {} of {} iterations above {} cycles",
+                 length, distance, avg, max, large_gaps, histogram.count(), threshold);
+            histogram.print("cycles");
+
+            const std::string prefix{ "pause_loop_" + std::to_string(length) + "_" + std::to_string(distance) };
+            BENCHMARK_RESULT((prefix + "_cycles").c_str(), avg, "cycles");
+            BENCHMARK_RESULT((prefix + "_large_gaps").c_str(), large_gaps, "count");
+        }
+    }
+}
+
+BARETEST_RUN;
@@ -0,0 +1,203 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/per_cpu.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/output_capture.hpp>
+#include <toyos/util/string.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+void prologue()
+{
+    smp::init();
+}
+
+TEST_CASE(bsp_is_cpu_0)
+{
+    BARETEST_ASSERT(smp::current_cpu() == 0);
+}
+
+TEST_CASE_PARALLEL(apic_ids_are_unique)
+{
+    for (size_t a = 0; a < smp::cpu_count(); a++) {
+        for (size_t b = a + 1; b < smp::cpu_count(); b++) {
+            BARETEST_ASSERT(smp::apic_id(a) != smp::apic_id(b));
+        }
+    }
+}
+
+TEST_CASE_CONDITIONAL(functions_run_on_the_requested_ap, smp::cpu_count() > 1)
+{
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        BARETEST_ASSERT(smp::run_on(cpu, [] { return smp::current_cpu(); }) == cpu);
+    }
+}
+
+TEST_CASE_CONDITIONAL(aps_are_reusable, smp::cpu_count() > 1)
+{
+    unsigned counter{ 0 };
+
+    for (unsigned round = 0; round < 1000; round++) {
+        smp::run_on(1, [&counter] { counter++; });
+    }
+
+    BARETEST_ASSERT(counter == 1000);
+}
+
+TEST_CASE_CONDITIONAL(aps_run_concurrently, smp::cpu_count() > 2)
+{
+    std::atomic<size_t> arrived{ 0 };
+    const size_t aps{ smp::cpu_count() - 1 };
+
+    // Every AP only returns once all APs are running at the same time.
+    const std::function<void()> barrier{ [&arrived, aps] {
+        arrived++;
+        while (arrived.load() < aps) {
+            cpu_pause();
+        }
+    } };
+
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        smp::start_on(cpu, barrier);
+    }
+
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        smp::wait_for(cpu);
+    }
+
+    BARETEST_ASSERT(arrived.load() == aps);
+}
+
+static constexpr unsigned LINES_PER_CPU{ 100 };
+
+/// Parse a number at the start of str and remove it from str.
+static std::optional<size_t> consume_number(std::string_view& str)
+{
+    size_t digits{ 0 };
+    size_t value{ 0 };
+    for (; digits < str.size() and str[digits] >= '0' and str[digits] <= '9'; digits++) {
+        value = value * 10 + static_cast<size_t>(str[digits] - '0');
+    }
+
+    if (digits == 0) {
+        return {};
+    }
+    str.remove_prefix(digits);
+    return value;
+}
+
+/// Parse a line printed by print_lines() into the CPU and the line number.
+static std::optional<std::pair<size_t, size_t>> parse_line(std::string_view line)
+{
+    static constexpr std::string_view CPU{ "CPU " };
+    static constexpr std::string_view PRINTS{ " prints line " };
+
+    if (line.substr(0, CPU.size()) != CPU) {
+        return {};
+    }
+    line.remove_prefix(CPU.size());
+
+    const auto cpu{ consume_number(line) };
+    if (not cpu or line.substr(0, PRINTS.size()) != PRINTS) {
+        return {};
+    }
+    line.remove_prefix(PRINTS.size());
+
+    const auto number{ consume_number(line) };
+    if (not number or not line.empty()) {
+        return {};
+    }
+    return std::pair{ *cpu, *number };
+}
+
+TEST_CASE_CONDITIONAL(aps_can_print_concurrently, smp::cpu_count() > 1)
+{
+    output_capture capture;
+
+    const std::function<void()> print_lines{ [] {
+        for (unsigned i = 0; i < LINES_PER_CPU; i++) {
+            printf("CPU %zu prints line %u\n", smp::current_cpu(), i);
+        }
+    } };
+
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        smp::start_on(cpu, print_lines);
+    }
+
+    print_lines();
+
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        smp::wait_for(cpu);
+    }
+
+    // Every line has to arrive intact, and the lines of each CPU in the order they were printed.
+    std::vector<size_t> next_line(smp::cpu_count(), 0);
+    for (const auto& line : util::string::split(capture.output(), '\n')) {
+        std::string_view text{ line };
+        if (not text.empty() and text.back() == '\r') {
+            text.remove_suffix(1);
+        }
+        if (text.find("CPU ") == std::string_view::npos) {
+            continue;
+        }
+
+        const auto parsed{ parse_line(text) };
+        BARETEST_ASSERT(parsed.has_value());
+
+        const auto [cpu, number] = *parsed;
+        BARETEST_ASSERT(cpu < smp::cpu_count());
+        BARETEST_ASSERT(number == next_line[cpu]);
+        next_line[cpu]++;
+    }
+
+    for (size_t cpu = 0; cpu < smp::cpu_count(); cpu++) {
+        BARETEST_ASSERT(next_line[cpu] == LINES_PER_CPU);
+    }
+}
+
+TEST_CASE_CONDITIONAL(per_cpu_areas_belong_to_their_cpu, smp::cpu_count() > 1)
+{
+    BARETEST_ASSERT(&smp::this_cpu() == &smp::cpu_area(0));
+
+    for (size_t cpu = 1; cpu < smp::cpu_count(); cpu++) {
+        BARETEST_ASSERT(smp::run_on(cpu, [] { return &smp::this_cpu(); }) == &smp::cpu_area(cpu));
+        BARETEST_ASSERT(smp::cpu_area(cpu).cpu == cpu);
+    }
+}
+
+TEST_CASE_CONDITIONAL(ap_allocations_use_arenas, smp::cpu_count() > 1)
+{
+    auto arena_allocations{ [] {
+        const auto& stats{ smp::this_cpu().stats };
+        const uint64_t before{ stats.arena_allocations };
+        auto p{ std::make_unique<uint64_t>(0) };
+        return stats.arena_allocations - before;
+    } };
+
+    BARETEST_ASSERT(smp::run_on(1, arena_allocations) == 1);
+}
+
+// The following test cases run on APs when the parallel-tests cmdline modifier is given.
+
+TEST_CASE_PARALLEL(parallel_cases_can_allocate)
+{
+    std::vector<std::string> strings;
+    for (unsigned i = 0; i < 100; i++) {
+        strings.push_back(std::to_string(i));
+    }
+
+    info("Running on CPU {}", smp::current_cpu());
+    BARETEST_ASSERT(strings.back() == "99");
+}
+
+BARETEST_RUN;
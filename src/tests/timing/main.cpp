@@ -2,38 +2,95 @@
 //
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdlib>
+#include <optional>
+#include <string>
+
 #include <toyos/baretest/baretest.hpp>
+#include <toyos/boot_cmdline.hpp>
+#include <toyos/cmdline.hpp>
+#include <toyos/testhelper/lapic_test_tools.hpp>
+#include <toyos/testhelper/statistics.hpp>
 #include <toyos/x86/x86asm.hpp>
 
-TEST_CASE(tsc_is_monotonous)
+using lapic_test_tools::tsc_ticks_per_second;
+
+/// Returns nothing unless the string is a positive number of seconds.
+static std::optional<uint64_t> parse_duration(const std::string& str)
 {
-    // Run for at least some minutes.
-    static constexpr size_t REPETITIONS{ 200 };
-
-    for (size_t round = 0; round < REPETITIONS; round++) {
-        // This _very roughly_ aims for REPETITIONS seconds at this many GHz.
-        static constexpr size_t LOOPS{ 1 /* Giga */ * 1000000000 };
-
-        const uint64_t tsc_before{ rdtsc() };
-
-        for (size_t i = 0; i < LOOPS; i++) {
-            // During this time, the VM can be paused and unpaused or similar.
-            //
-            // We cannot use PAUSE here, because its execution time is wildly
-            // different for different processors and we are aiming for a
-            // somewhat constant delay. Instead we use this empty assembler
-            // statement to force the compiler to actually loop.
-            asm volatile("");
-        }
+    char* end{ nullptr };
+    const uint64_t duration_s{ strtoul(str.c_str(), &end, 10) };
+    if (end == str.c_str() or *end != '\0' or duration_s == 0) {
+        return {};
+    }
+    return duration_s;
+}
+
+static uint64_t jitter_duration_seconds()
+{
+    auto parser{ cmdline::cmdline_parser(get_boot_cmdline().value_or("")) };
+    const std::string option{ parser.jitter_duration_option() };
+
+    if (const auto duration_s{ parse_duration(option) }) {
+        return *duration_s;
+    }
+
+    // Without the modifier, the parser hands out the default.
+    const std::string fallback{ cmdline::cmdline_parser("").jitter_duration_option() };
+    warning("Invalid jitter duration '{s}', using {s} s instead", option.c_str(), fallback.c_str());
+    return *parse_duration(fallback);
+}
 
-        const uint64_t tsc_after{ rdtsc() };
+TEST_CASE(tsc_jitter)
+{
+    // Gaps shorter than this are considered the regular cost of a loop iteration.
+    static constexpr uint64_t THRESHOLD_US{ 1 };
+
+    const uint64_t ticks_per_us{ std::max(tsc_ticks_per_second() / 1000000, 1ul) };
+    const uint64_t threshold{ THRESHOLD_US * ticks_per_us };
+    const uint64_t duration_s{ jitter_duration_seconds() };
+
+    info("Measuring jitter for {} s, TSC at {} ticks/us, threshold {} ticks", duration_s, ticks_per_us, threshold);
 
-        // Be verbose for debugging.
-        info("{}: TSC {} - {} = {}", round, tsc_after, tsc_before, tsc_after - tsc_before);
+    statistics::log2_histogram histogram;
+    uint64_t preemptions{ 0 };
+    uint64_t stolen{ 0 };
+    uint64_t longest{ 0 };
+    uint64_t backwards{ 0 };
 
-        BARETEST_ASSERT(tsc_before < tsc_after);
+    // During this time, the VM can be preempted, paused and unpaused or similar.
+    // Any of these show up as a gap between two TSC reads.
+    uint64_t prev{ rdtsc() };
+    const uint64_t end{ prev + duration_s * tsc_ticks_per_second() };
+
+    while (prev < end) {
+        const uint64_t now{ rdtsc() };
+
+        if (now < prev) {
+            backwards++;
+        }
+        else if (now - prev > threshold) {
+            const uint64_t gap{ now - prev };
+            preemptions++;
+            stolen += gap;
+            longest = std::max(longest, gap);
+            histogram.record(gap / ticks_per_us);
+        }
+
+        prev = now;
     }
+
+    info("Gap histogram:");
+    histogram.print("us");
+    info("Preemptions: {}, stolen: {} us, longest gap: {} us", preemptions, stolen / ticks_per_us, longest / ticks_per_us);
+
+    BENCHMARK_RESULT("jitter_preemptions", preemptions, "count");
+    BENCHMARK_RESULT("jitter_stolen_time", stolen / ticks_per_us, "us");
+    BENCHMARK_RESULT("jitter_longest_gap", longest / ticks_per_us, "us");
+
+    BARETEST_ASSERT(backwards == 0);
 }
 
 BARETEST_RUN;
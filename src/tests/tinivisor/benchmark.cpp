@@ -0,0 +1,91 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <toyos/x86/cpuid.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+#include <toyos/tinivisor.hpp>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/testhelper/statistics.hpp>
+
+// Defined in main.cpp
+extern tinivisor tini;
+
+// Tinivisor does not enable secondary processor-based controls, so RDTSCP raises #UD in the nested guest.
+// All measurements taken while tinivisor is running hence use RDTSC.
+
+static constexpr size_t ROUNDS{ 10000 };
+static constexpr size_t WARMUP_ROUNDS{ 100 };
+
+/**
+ * \brief Emulate CPUID by forwarding it to the host.
+ *
+ * This is the minimal amount of work a CPUID exit handler has to do.
+ */
+static void cpuid_passthrough(vmcs::vmcs_t& vmcs, tinivisor::guest_regs& regs, x86::vmx_exit_reason /*reason*/, uint64_t /*exit_qual*/)
+{
+    auto result{ cpuid(regs.rax, regs.rcx) };
+    regs.rax = result.eax;
+    regs.rbx = result.ebx;
+    regs.rcx = result.ecx;
+    regs.rdx = result.edx;
+    vmcs.adjust_rip();
+}
+
+TEST_CASE(tinivisor_benchmark_vmcall_round_trip)
+{
+    tini.reset();
+    tini.start();
+
+    auto data{ statistics::measure_cycles(tinivisor::hypercall_nop, ROUNDS, WARMUP_ROUNDS, rdtsc) };
+
+    tini.stop();
+
+    info("VMCALL round trip: avg {} min {} max {}", data.avg(), data.min(), data.max());
+    BENCHMARK_RESULT("tinivisor_vmcall_cycles", data.avg(), "cycles");
+}
+
+TEST_CASE(tinivisor_benchmark_cpuid_exit)
+{
+    tini.reset();
+    tini.register_handler(x86::vmx_exit_reason::CPUID, cpuid_passthrough);
+    tini.start();
+
+    auto data{ statistics::measure_cycles([] { cpuid(CPUID_LEAF_FAMILY_FEATURES); }, ROUNDS, WARMUP_ROUNDS, rdtsc) };
+
+    tini.stop();
+    tini.reset();
+
+    info("CPUID exit: avg {} min {} max {}", data.avg(), data.min(), data.max());
+    BENCHMARK_RESULT("tinivisor_cpuid_exit_cycles", data.avg(), "cycles");
+}
+
+TEST_CASE(tinivisor_benchmark_start_stop)
+{
+    static constexpr size_t START_STOP_ROUNDS{ 1000 };
+
+    statistics::data<uint64_t> start_data;
+    statistics::data<uint64_t> stop_data;
+    start_data.reserve(START_STOP_ROUNDS);
+    stop_data.reserve(START_STOP_ROUNDS);
+
+    tini.reset();
+
+    for (size_t round{ 0 }; round < START_STOP_ROUNDS; ++round) {
+        auto before_start{ rdtsc() };
+        tini.start();
+        auto after_start{ rdtsc() };
+        tini.stop();
+        auto after_stop{ rdtsc() };
+
+        start_data.push(after_start - before_start);
+        stop_data.push(after_stop - after_start);
+    }
+
+    info("start(): avg {} min {} max {}", start_data.avg(), start_data.min(), start_data.max());
+    info("stop(): avg {} min {} max {}", stop_data.avg(), stop_data.min(), stop_data.max());
+    BENCHMARK_RESULT("tinivisor_start_cycles", start_data.avg(), "cycles");
+    BENCHMARK_RESULT("tinivisor_stop_cycles", stop_data.avg(), "cycles");
+}
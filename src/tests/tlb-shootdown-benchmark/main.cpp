@@ -0,0 +1,243 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <atomic>
+#include <string>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/mm.hpp>
+#include <toyos/pd.hpp>
+#include <toyos/pt.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/testhelper/irq_handler.hpp>
+#include <toyos/testhelper/lapic_test_tools.hpp>
+#include <toyos/testhelper/statistics.hpp>
+#include <toyos/util/cast_helpers.hpp>
+#include <toyos/util/literals.hpp>
+#include <toyos/x86/x86asm.hpp>
+
+using namespace lapic_test_tools;
+
+// A TLB shootdown as an operating system does it: the initiating CPU changes a PTE, flushes its own TLB entry and
+// sends an IPI to every other CPU that may have cached the translation. Each target flushes the entry with INVLPG
+// in its IPI handler and acknowledges. The initiator waits for all acknowledgements.
+//
+// The latency is measured on the initiator for 1..N targets. Targets either spin with interrupts enabled, which
+// shows the cost of the IPI and INVLPG paths of the VMM, or wait in HLT, which adds the wake-up latency of an idle
+// vCPU.
+
+static constexpr unsigned ROUNDS{ 500 };
+static constexpr unsigned WARM_UP_ROUNDS{ 50 };
+
+static constexpr uint8_t SHOOTDOWN_VECTOR{ 0x40 };
+
+/// The page whose mapping changes. It lives in a 2 MiB region that is mapped with 4 KiB pages by prologue().
+alignas(2_MiB) static uint8_t test_region[2_MiB];
+
+/// Page table that maps test_region with 4 KiB pages.
+alignas(PAGE_SIZE) static PT test_region_pt;
+
+/// The two frames that are alternately mapped to the test page. Each contains its own marker.
+alignas(PAGE_SIZE) static uint64_t frames[2][PAGE_SIZE / sizeof(uint64_t)];
+
+static const lin_addr_t TEST_ADDR{ lin_addr_t(uintptr_t(test_region)) };
+
+struct alignas(CPU_CACHE_LINE_SIZE) target_state
+{
+    std::atomic<uint64_t> acks{ 0 };
+
+    /// Marker that was read from the test page after the flush.
+    std::atomic<uint64_t> seen{ 0 };
+};
+
+static target_state targets[smp::MAX_CPUS];
+
+static std::atomic<size_t> targets_ready{ 0 };
+static std::atomic<bool> stop_waiting{ false };
+
+enum class wait_mode
+{
+    SPIN,
+    HALT,
+};
+
+static uint64_t read_test_page()
+{
+    return *num_to_ptr<volatile uint64_t>(uintptr_t(TEST_ADDR));
+}
+
+static void shootdown_handler(intr_regs* regs)
+{
+    PANIC_UNLESS(regs->vector == SHOOTDOWN_VECTOR, "Unexpected vector {}", regs->vector);
+
+    auto& state{ targets[smp::current_cpu()] };
+
+    memory_manager::invalidate_tlb(TEST_ADDR);
+    state.seen.store(read_test_page(), std::memory_order_relaxed);
+
+    send_eoi();
+    state.acks.fetch_add(1, std::memory_order_release);
+}
+
+/// Keep the translation of the test page cached until stop_waiting is set.
+static void wait_for_shootdowns(wait_mode mode)
+{
+    software_apic_enable();
+    read_test_page();
+
+    enable_interrupts();
+    targets_ready++;
+
+    if (mode == wait_mode::HALT) {
+        // Check the stop flag with interrupts disabled. The interrupt shadow of STI covers the HLT, so the stop IPI
+        // cannot arrive between the check and the HLT.
+        disable_interrupts();
+        while (not stop_waiting.load(std::memory_order_acquire)) {
+            enable_interrupts_and_halt();
+            disable_interrupts();
+        }
+        return;
+    }
+
+    while (not stop_waiting.load(std::memory_order_acquire)) {
+        read_test_page();
+        cpu_pause();
+    }
+
+    disable_interrupts();
+}
+
+/// Remap the test page to the given frame and flush the translation on the initiator and all targets.
+static void shoot_down(size_t frame, size_t target_count)
+{
+    uint64_t before[smp::MAX_CPUS];
+    for (size_t cpu = 1; cpu <= target_count; cpu++) {
+        before[cpu] = targets[cpu].acks.load(std::memory_order_acquire);
+    }
+
+    memory_manager::pt_entry(TEST_ADDR).set_phys_addr(phy_addr_t(uintptr_t(frames[frame])), tlb_invalidation::no);
+    memory_manager::invalidate_tlb(TEST_ADDR);
+
+    for (size_t cpu = 1; cpu <= target_count; cpu++) {
+        send_ipi(SHOOTDOWN_VECTOR, smp::apic_id(cpu));
+    }
+
+    for (size_t cpu = 1; cpu <= target_count; cpu++) {
+        while (targets[cpu].acks.load(std::memory_order_acquire) == before[cpu]) {
+            cpu_pause();
+        }
+    }
+}
+
+struct shootdown_result
+{
+    uint64_t latency;        ///< Average latency of a shootdown in cycles.
+    bool stale_translation;  ///< Set if a target still saw the old frame after a shootdown.
+};
+
+/// Measure shootdowns to CPUs 1..target_count.
+static shootdown_result measure_shootdowns(size_t target_count, wait_mode mode)
+{
+    statistics::data<uint64_t> latencies;
+    bool stale_translation{ false };
+
+    targets_ready = 0;
+    stop_waiting = false;
+
+    const std::function<void()> target_fn{ [mode] { wait_for_shootdowns(mode); } };
+    for (size_t cpu = 1; cpu <= target_count; cpu++) {
+        smp::start_on(cpu, target_fn);
+    }
+
+    while (targets_ready.load() < target_count) {
+        cpu_pause();
+    }
+
+    for (unsigned round = 0; round < WARM_UP_ROUNDS + ROUNDS; round++) {
+        const size_t frame{ round % 2 };
+
+        const uint64_t start{ rdtsc() };
+        shoot_down(frame, target_count);
+        const uint64_t end{ rdtsc() };
+
+        if (round >= WARM_UP_ROUNDS) {
+            latencies.push(end - start);
+        }
+
+        for (size_t cpu = 1; cpu <= target_count; cpu++) {
+            stale_translation |= targets[cpu].seen.load(std::memory_order_relaxed) != frames[frame][0];
+        }
+    }
+
+    // Halted targets only notice the stop flag after another interrupt.
+    stop_waiting.store(true, std::memory_order_release);
+    for (size_t cpu = 1; cpu <= target_count; cpu++) {
+        send_ipi(SHOOTDOWN_VECTOR, smp::apic_id(cpu));
+        smp::wait_for(cpu);
+    }
+
+    return { latencies.avg(), stale_translation };
+}
+
+/// Returns false if a target used a stale translation after a shootdown.
+static bool benchmark_shootdowns(wait_mode mode, const std::string& prefix)
+{
+    irq_handler::guard _{ shootdown_handler };
+    bool translations_fresh{ true };
+
+    for (size_t target_count = 1; target_count < smp::cpu_count(); target_count++) {
+        const auto result{ measure_shootdowns(target_count, mode) };
+
+        if (result.stale_translation) {
+            info("{s} shootdown to {} CPUs: a target used a stale translation", prefix.c_str(), target_count);
+            translations_fresh = false;
+        }
+
+        info("{s} shootdown to {} CPUs: {} cycles", prefix.c_str(), target_count, result.latency);
+        BENCHMARK_RESULT(("tlb_shootdown_" + prefix + "_" + std::to_string(target_count) + "_targets").c_str(), result.latency, "cycles");
+    }
+
+    return translations_fresh;
+}
+
+void prologue()
+{
+    mask_pic();
+    software_apic_enable();
+    smp::init();
+
+    frames[0][0] = 0xf00;
+    frames[1][0] = 0xf01;
+
+    // The boot page tables map everything with 2 MiB pages. Split the test region, so the test page has a PTE.
+    uintptr_t page{ uintptr_t(test_region) };
+    for (auto& pte : test_region_pt) {
+        pte = PTE({ .address = page, .present = true, .readwrite = true, .usermode = true });
+        page += PAGE_SIZE;
+    }
+
+    memory_manager::pd_entry(TEST_ADDR) = PDE::pde_to_pt({ .address = uintptr_t(&test_region_pt), .present = true, .readwrite = true, .usermode = true });
+
+    // All CPUs share the boot page tables.
+    for (size_t cpu = 0; cpu < smp::cpu_count(); cpu++) {
+        if (cpu == 0) {
+            memory_manager::invalidate_tlb_non_global();
+        }
+        else {
+            smp::run_on(cpu, memory_manager::invalidate_tlb_non_global);
+        }
+    }
+}
+
+TEST_CASE_CONDITIONAL(benchmark_shootdowns_to_spinning_cpus, smp::cpu_count() > 1)
+{
+    BARETEST_ASSERT(benchmark_shootdowns(wait_mode::SPIN, "spin"));
+}
+
+TEST_CASE_CONDITIONAL(benchmark_shootdowns_to_halted_cpus, smp::cpu_count() > 1)
+{
+    BARETEST_ASSERT(benchmark_shootdowns(wait_mode::HALT, "halt"));
+}
+
+BARETEST_RUN;
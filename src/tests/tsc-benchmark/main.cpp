@@ -0,0 +1,78 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <string>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/testhelper/statistics.hpp>
+#include <toyos/x86/cpuid.hpp>
+#include <toyos/x86/x86asm.hpp>
+#include <toyos/x86/x86defs.hpp>
+
+// Whether time reads exit depends on how the VMM sets up TSC offsetting and scaling. Some VMMs fall back to
+// trapping RDTSC after the guest wrote the TSC. Hence, the latencies are measured on a pristine TSC first
+// and again after each kind of TSC write. The test cases depend on running in this order.
+
+static constexpr unsigned REPETITIONS{ 10000 };
+static constexpr unsigned WARM_UP_ROUNDS{ 1000 };
+
+static bool tsc_adjust_supported()
+{
+    return cpuid(CPUID_LEAF_EXTENDED_FEATURES).ebx & LVL_0000_0007_EBX_TSCADJUST;
+}
+
+static bool rdtscp_supported()
+{
+    return cpuid(CPUID_LEAF_EXTENDED_PROCESSOR_INFO).edx & LVL_8000_0001_EDX_TSCP;
+}
+
+static bool rdpid_supported()
+{
+    return cpuid(CPUID_LEAF_EXTENDED_FEATURES).ecx & LVL_0000_0007_ECX_RDPID;
+}
+
+template<typename FN>
+static void benchmark_time_read(const std::string& name, FN f)
+{
+    // RDTSC is used as clock, because RDTSCP itself is one of the candidates.
+    auto data{ statistics::measure_cycles(f, REPETITIONS, WARM_UP_ROUNDS, rdtsc) };
+
+    info("{s}: avg {} min {} max {}", name.c_str(), data.avg(), data.min(), data.max());
+    BENCHMARK_RESULT(name.c_str(), data.avg(), "cycles");
+}
+
+static void benchmark_time_reads(const std::string& phase)
+{
+    benchmark_time_read("rdtsc_" + phase + "_cycles", [] { rdtsc(); });
+
+    if (rdtscp_supported()) {
+        benchmark_time_read("rdtscp_" + phase + "_cycles", [] { rdtscp(); });
+    }
+
+    if (rdpid_supported()) {
+        benchmark_time_read("rdpid_" + phase + "_cycles", [] { rdpid(); });
+    }
+
+    benchmark_time_read("rdmsr_tsc_" + phase + "_cycles", [] { rdmsr(x86::msr::IA32_TIME_STAMP_COUNTER); });
+}
+
+TEST_CASE(benchmark_time_reads_initial)
+{
+    benchmark_time_reads("initial");
+}
+
+TEST_CASE(benchmark_time_reads_after_tsc_write)
+{
+    wrmsr(x86::msr::IA32_TIME_STAMP_COUNTER, 0xf000000000ul);
+    benchmark_time_reads("tsc_write");
+}
+
+TEST_CASE_CONDITIONAL(benchmark_time_reads_after_tsc_adjust_write, tsc_adjust_supported())
+{
+    wrmsr(x86::msr::IA32_TSC_ADJUST, 0);
+    wrmsr(x86::msr::IA32_TSC_ADJUST, 0xf000000000000000ul - rdtsc());
+    benchmark_time_reads("tsc_adjust_write");
+}
+
+BARETEST_RUN;
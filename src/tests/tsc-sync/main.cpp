@@ -0,0 +1,202 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <toyos/baretest/baretest.hpp>
+#include <toyos/smp.hpp>
+#include <toyos/util/spinlock.hpp>
+#include <toyos/x86/cpuid.hpp>
+#include <toyos/x86/x86asm.hpp>
+#include <toyos/x86/x86defs.hpp>
+
+// Guests only use the TSC as clocksource if the TSCs of all CPUs are synchronized. Operating systems check this
+// like the warp test below and fall back to much slower clocksources otherwise.
+//
+// The warp test lets two CPUs take turns reading the TSC under a lock. Every read happens after the previous one,
+// so a value lower than the previous one is a backward step of time. The skew measurement estimates the offset
+// between two TSCs from a cache-line handshake: the remote CPU reads its TSC between two reads of the reference
+// CPU, so its value should be in the middle of them. The handshake with the shortest round trip gives the best
+// estimate.
+
+static constexpr unsigned WARP_ROUNDS{ 100000 };
+static constexpr unsigned HANDSHAKE_ROUNDS{ 1000 };
+
+/// TSC_ADJUST of one CPU is moved by this amount, which is far beyond any measurement error.
+static constexpr int64_t ADJUST_DELTA{ 1 << 24 };
+static constexpr uint64_t SKEW_TOLERANCE{ 100000 };
+
+static bool tsc_adjust_supported()
+{
+    return cpuid(0x7).ebx & LVL_0000_0007_EBX_TSCADJUST;
+}
+
+/// A TSC read that is not executed earlier than the preceding instructions.
+static uint64_t ordered_rdtsc()
+{
+    asm volatile("lfence" ::: "memory");
+    const uint64_t tsc{ rdtsc() };
+    asm volatile("lfence" ::: "memory");
+    return tsc;
+}
+
+struct warp_result
+{
+    uint64_t backward_steps{ 0 };
+    uint64_t max_warp{ 0 };
+};
+
+static warp_result check_warp(size_t first, size_t second)
+{
+    spinlock lock;
+    uint64_t last_tsc{ 0 };
+    warp_result result;
+
+    smp::run_together({ first, second }, [&](size_t) {
+        for (unsigned round = 0; round < WARP_ROUNDS; round++) {
+            spinlock::guard _{ lock };
+
+            const uint64_t now{ ordered_rdtsc() };
+            if (now < last_tsc) {
+                result.backward_steps++;
+                result.max_warp = std::max(result.max_warp, last_tsc - now);
+            }
+            last_tsc = now;
+        }
+    });
+
+    return result;
+}
+
+struct skew_result
+{
+    int64_t offset{ 0 };         ///< TSC of the remote CPU minus the TSC of the reference CPU
+    uint64_t round_trip{ ~0ul };  ///< round trip of the handshake the offset was estimated from
+};
+
+static skew_result measure_skew(size_t reference, size_t remote)
+{
+    struct alignas(CPU_CACHE_LINE_SIZE) handshake
+    {
+        std::atomic<uint64_t> request{ 0 };
+        std::atomic<uint64_t> reply{ 0 };
+        uint64_t remote_tsc{ 0 };
+    } hs;
+
+    skew_result result;
+
+    smp::run_together({ reference, remote }, [&](size_t side) {
+        for (uint64_t round = 1; round <= HANDSHAKE_ROUNDS; round++) {
+            if (side == 1) {
+                while (hs.request.load(std::memory_order_acquire) != round) {
+                    cpu_pause();
+                }
+                hs.remote_tsc = ordered_rdtsc();
+                hs.reply.store(round, std::memory_order_release);
+                continue;
+            }
+
+            const uint64_t start{ ordered_rdtsc() };
+            hs.request.store(round, std::memory_order_release);
+            while (hs.reply.load(std::memory_order_acquire) != round) {
+                cpu_pause();
+            }
+            const uint64_t end{ ordered_rdtsc() };
+
+            if (end - start < result.round_trip) {
+                result.round_trip = end - start;
+                result.offset = static_cast<int64_t>(hs.remote_tsc - (start + result.round_trip / 2));
+            }
+        }
+    });
+
+    return result;
+}
+
+static uint64_t abs_offset(int64_t offset)
+{
+    return static_cast<uint64_t>(offset < 0 ? -offset : offset);
+}
+
+void prologue()
+{
+    smp::init();
+}
+
+TEST_CASE_CONDITIONAL(tsc_does_not_warp_between_cpus, smp::cpu_count() > 1)
+{
+    uint64_t backward_steps{ 0 }, max_warp{ 0 };
+
+    for (size_t first = 0; first < smp::cpu_count(); first++) {
+        for (size_t second = first + 1; second < smp::cpu_count(); second++) {
+            const auto result{ check_warp(first, second) };
+
+            if (result.backward_steps != 0) {
+                info("TSC warp between CPU {} and CPU {}: {} backward steps, up to {} cycles", first, second, result.backward_steps, result.max_warp);
+            }
+
+            backward_steps += result.backward_steps;
+            max_warp = std::max(max_warp, result.max_warp);
+        }
+    }
+
+    BENCHMARK_RESULT("tsc_backward_steps", backward_steps, "steps");
+    BENCHMARK_RESULT("tsc_max_warp", max_warp, "cycles");
+    BARETEST_ASSERT(backward_steps == 0);
+}
+
+TEST_CASE_CONDITIONAL(benchmark_tsc_skew, smp::cpu_count() > 1)
+{
+    uint64_t max_skew{ 0 }, max_round_trip{ 0 };
+
+    for (size_t first = 0; first < smp::cpu_count(); first++) {
+        for (size_t second = first + 1; second < smp::cpu_count(); second++) {
+            const auto result{ measure_skew(first, second) };
+
+            info("TSC of CPU {} relative to CPU {}: {} cycles (handshake round trip {} cycles)", second, first, result.offset, result.round_trip);
+
+            max_skew = std::max(max_skew, abs_offset(result.offset));
+            max_round_trip = std::max(max_round_trip, result.round_trip);
+        }
+    }
+
+    BENCHMARK_RESULT("tsc_max_skew", max_skew, "cycles");
+    BENCHMARK_RESULT("tsc_handshake_round_trip", max_round_trip, "cycles");
+}
+
+TEST_CASE_CONDITIONAL(tsc_adjust_write_only_shifts_tsc_of_its_cpu, smp::cpu_count() > 1 and tsc_adjust_supported())
+{
+    static constexpr size_t ADJUSTED_CPU{ 1 };
+
+    const auto before{ measure_skew(0, ADJUSTED_CPU) };
+    const uint64_t old_adjust{ smp::run_on(ADJUSTED_CPU, [] { return rdmsr(x86::msr::IA32_TSC_ADJUST); }) };
+
+    // Move the TSC of one CPU ahead. The other CPU now sees time going backwards.
+    smp::run_on(ADJUSTED_CPU, [old_adjust] { wrmsr(x86::msr::IA32_TSC_ADJUST, old_adjust + ADJUST_DELTA); });
+
+    const auto shifted{ measure_skew(0, ADJUSTED_CPU) };
+    const auto shifted_warp{ check_warp(0, ADJUSTED_CPU) };
+
+    info("TSC offset after moving TSC_ADJUST by {}: {} cycles, {} backward steps", ADJUST_DELTA, shifted.offset, shifted_warp.backward_steps);
+
+    // Writing the old value back, as operating systems do to repair skew, must restore the previous offset.
+    smp::run_on(ADJUSTED_CPU, [old_adjust] { wrmsr(x86::msr::IA32_TSC_ADJUST, old_adjust); });
+
+    const auto restored{ measure_skew(0, ADJUSTED_CPU) };
+    const auto restored_warp{ check_warp(0, ADJUSTED_CPU) };
+
+    info("TSC offset after restoring TSC_ADJUST: {} cycles, {} backward steps", restored.offset, restored_warp.backward_steps);
+
+    BENCHMARK_RESULT("tsc_skew_after_adjust", abs_offset(restored.offset), "cycles");
+
+    BARETEST_ASSERT(abs_offset(shifted.offset - before.offset - ADJUST_DELTA) <= SKEW_TOLERANCE);
+    BARETEST_ASSERT(shifted_warp.backward_steps != 0);
+    BARETEST_ASSERT(abs_offset(restored.offset - before.offset) <= SKEW_TOLERANCE);
+    BARETEST_ASSERT(restored_warp.backward_steps == 0);
+}
+
+BARETEST_RUN;
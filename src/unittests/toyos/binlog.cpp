@@ -0,0 +1,74 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <toyos/util/binlog.hpp>
+
+static std::vector<uint8_t> bytes_of(binlog::record& rec)
+{
+    auto* data = reinterpret_cast<const uint8_t*>(rec.data());
+    return { data, data + rec.size() };
+}
+
+static std::vector<uint8_t> payload_of(binlog::record& rec)
+{
+    auto all = bytes_of(rec);
+    return { all.begin() + binlog::HEADER_SIZE + sizeof(uint32_t), all.end() };
+}
+
+TEST_CASE("record header contains marker, version, length and site")
+{
+    binlog::record rec{ 0x12345678 };
+    CHECK(bytes_of(rec) == std::vector<uint8_t>{ binlog::RECORD_MARKER, binlog::VERSION, 4, 0x78, 0x56, 0x34, 0x12 });
+}
+
+TEST_CASE("unsigned arguments are LEB128 encoded")
+{
+    binlog::record rec{ 0 };
+    rec.add(0u);
+    rec.add(127u);
+    rec.add(128u);
+    rec.add(~0ull);
+    CHECK(payload_of(rec) == std::vector<uint8_t>{ 0x00, 0x7f, 0x80, 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 });
+    CHECK(bytes_of(rec)[2] == 4 + 14);
+}
+
+TEST_CASE("signed arguments are zigzag encoded")
+{
+    binlog::record rec{ 0 };
+    rec.add(0);
+    rec.add(-1);
+    rec.add(1);
+    rec.add(-64l);
+    CHECK(payload_of(rec) == std::vector<uint8_t>{ 0x00, 0x01, 0x02, 0x7f });
+}
+
+TEST_CASE("strings are sent with their length")
+{
+    binlog::record rec{ 0 };
+    const char* str{ "abc" };
+    rec.add(str);
+    rec.add("");
+    CHECK(payload_of(rec) == std::vector<uint8_t>{ 3, 'a', 'b', 'c', 0 });
+}
+
+TEST_CASE("argument types are known at compile time")
+{
+    using sig = decltype(binlog::signature_of(1, 2u, "x", static_cast<void*>(nullptr), -1l, true));
+    CHECK(std::string(sig::value) == "iusuiu");
+    CHECK(std::string(decltype(binlog::signature_of())::value).empty());
+}
+
+TEST_CASE("records that do not fit are marked as overflowed")
+{
+    binlog::record rec{ 0 };
+    const std::string long_string(binlog::MAX_RECORD_SIZE, 'x');
+    rec.add(long_string.c_str());
+    CHECK(rec.overflowed());
+    CHECK(rec.size() <= binlog::MAX_RECORD_SIZE);
+}
@@ -16,6 +16,7 @@ TEST_CASE("parsing empty cmdline only results in defaults")
     CHECK(!parsed.xhci_option().has_value());
     CHECK(parsed.xhci_power_option() == "0");  // default
     CHECK(parsed.disable_testcases_option().empty());
+    CHECK(parsed.trace_option().empty());
 }
 
 TEST_CASE("parsing '--serial'")
@@ -38,3 +39,42 @@ TEST_CASE("parsing '--disable-testcases'")
     CHECK(disable_tests[1] == "testB");
     CHECK(disable_tests[2] == "testC");
 }
+
+TEST_CASE("parsing '--trace'")
+{
+    auto input = "--trace=buddy,lapic";
+    auto parsed = cmdline::cmdline_parser(input);
+    auto categories = parsed.trace_option();
+    REQUIRE(categories.size() == 2);
+    CHECK(trace_category_mask(categories[0]) == TRACE_BUDDY);
+    CHECK(trace_category_mask(categories[1]) == TRACE_LAPIC);
+    CHECK(trace_category_mask("all") & TRACE_SRIOV);
+    CHECK(trace_category_mask("nonsense") == 0);
+
+    parsed = cmdline::cmdline_parser("--trace=-all,pci");
+    CHECK(parsed.trace_option() == std::vector<std::string>{ "-all", "pci" });
+}
+
+TEST_CASE("trace categories are added to and removed from the mask")
+{
+    uint64_t mask{ TRACE_BOOT | TRACE_PIC };
+
+    CHECK(apply_trace_category(mask, "lapic"));
+    CHECK(mask == (TRACE_BOOT | TRACE_PIC | TRACE_LAPIC));
+
+    CHECK(apply_trace_category(mask, "-pic"));
+    CHECK(mask == (TRACE_BOOT | TRACE_LAPIC));
+
+    // Removing a category that is not in the mask changes nothing.
+    CHECK(apply_trace_category(mask, "-pic"));
+    CHECK(mask == (TRACE_BOOT | TRACE_LAPIC));
+
+    CHECK(apply_trace_category(mask, "-all"));
+    CHECK(mask == 0);
+
+    CHECK_FALSE(apply_trace_category(mask, "nonsense"));
+    CHECK_FALSE(apply_trace_category(mask, "-nonsense"));
+    CHECK_FALSE(apply_trace_category(mask, "-"));
+    CHECK_FALSE(apply_trace_category(mask, ""));
+    CHECK(mask == 0);
+}
@@ -0,0 +1,64 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <toyos/console/console_shmem_util.hpp>
+#include <toyos/util/literals.hpp>
+
+static constexpr size_t MIN_SIZE{ 4_KiB };
+
+static const cbl::interval IMAGE{ 16_MiB, 32_MiB };
+
+TEST_CASE("shmem::parse_region() parses decimal and hex input")
+{
+    CHECK(shmem::parse_region("4096,8192") == cbl::interval::from_size(4096, 8192));
+    CHECK(shmem::parse_region("0x80000000,0x100000") == cbl::interval::from_size(0x80000000, 0x100000));
+    CHECK(shmem::parse_region("0x1000,4096") == cbl::interval::from_size(0x1000, 4096));
+}
+
+TEST_CASE("shmem::parse_region() rejects malformed input")
+{
+    CHECK_FALSE(shmem::parse_region(""));
+    CHECK_FALSE(shmem::parse_region("0x1000"));
+    CHECK_FALSE(shmem::parse_region("0x1000,"));
+    CHECK_FALSE(shmem::parse_region(",0x1000"));
+    CHECK_FALSE(shmem::parse_region("0x1000,0x1000,0x1000"));
+    CHECK_FALSE(shmem::parse_region("0x,0x1000"));
+    CHECK_FALSE(shmem::parse_region("abc,0x1000"));
+    CHECK_FALSE(shmem::parse_region("0x1000,0x10g0"));
+    CHECK_FALSE(shmem::parse_region("4096k,4096"));
+    CHECK_FALSE(shmem::parse_region("0xffffffffffff0000,0x20000"));
+}
+
+TEST_CASE("shmem::region_usable() accepts regions below 4 GiB outside the image")
+{
+    CHECK(shmem::region_usable(cbl::interval::from_size(0x100000, MIN_SIZE), MIN_SIZE, IMAGE));
+    CHECK(shmem::region_usable(cbl::interval{ 4_GiB - MIN_SIZE, 4_GiB }, MIN_SIZE, IMAGE));
+
+    // Regions may touch the image.
+    CHECK(shmem::region_usable(cbl::interval{ IMAGE.a - MIN_SIZE, IMAGE.a }, MIN_SIZE, IMAGE));
+    CHECK(shmem::region_usable(cbl::interval::from_size(IMAGE.b, MIN_SIZE), MIN_SIZE, IMAGE));
+}
+
+TEST_CASE("shmem::region_usable() rejects regions that are too small")
+{
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(0x100000, MIN_SIZE - 1), MIN_SIZE, IMAGE));
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(0x100000, 0), MIN_SIZE, IMAGE));
+}
+
+TEST_CASE("shmem::region_usable() rejects regions that are not below 4 GiB")
+{
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(4_GiB, MIN_SIZE), MIN_SIZE, IMAGE));
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(4_GiB - MIN_SIZE / 2, MIN_SIZE), MIN_SIZE, IMAGE));
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(64_GiB, 1_MiB), MIN_SIZE, IMAGE));
+}
+
+TEST_CASE("shmem::region_usable() rejects regions that overlap the image")
+{
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(IMAGE.a - MIN_SIZE / 2, MIN_SIZE), MIN_SIZE, IMAGE));
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(IMAGE.b - MIN_SIZE / 2, MIN_SIZE), MIN_SIZE, IMAGE));
+    CHECK_FALSE(shmem::region_usable(cbl::interval::from_size(IMAGE.a + 1_MiB, MIN_SIZE), MIN_SIZE, IMAGE));
+    CHECK_FALSE(shmem::region_usable(cbl::interval{ IMAGE.a - 1_MiB, IMAGE.b + 1_MiB }, MIN_SIZE, IMAGE));
+}
@@ -0,0 +1,117 @@
+// Copyright © 2024 Cyberus Technology GmbH <contact@cyberus-technology.de>
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <array>
+#include <cstdint>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <toyos/util/mpmc_queue.hpp>
+
+static constexpr size_t MAX_SIZE{ 8 };
+
+using queue_t = cbl::mpmc_queue<uint64_t, MAX_SIZE>;
+
+TEST_CASE("new queue is empty")
+{
+    cbl::static_mpmc_queue<uint64_t, MAX_SIZE> queue;
+
+    CHECK(queue.empty());
+    CHECK_FALSE(queue.pop().has_value());
+}
+
+TEST_CASE("elements are popped in the order they were pushed")
+{
+    cbl::static_mpmc_queue<uint64_t, MAX_SIZE> queue;
+
+    for (uint64_t i = 0; i < 5; i++) {
+        REQUIRE(queue.push(i));
+    }
+    CHECK_FALSE(queue.empty());
+
+    for (uint64_t i = 0; i < 5; i++) {
+        const auto elem{ queue.pop() };
+        REQUIRE(elem.has_value());
+        CHECK(*elem == i);
+    }
+    CHECK(queue.empty());
+}
+
+TEST_CASE("push fails on a full queue")
+{
+    cbl::static_mpmc_queue<uint64_t, MAX_SIZE> queue;
+
+    for (uint64_t i = 0; i < MAX_SIZE; i++) {
+        REQUIRE(queue.push(i));
+    }
+    CHECK_FALSE(queue.push(MAX_SIZE));
+
+    // Popping one element makes room for exactly one more.
+    CHECK(queue.pop() == 0u);
+    CHECK(queue.push(MAX_SIZE));
+    CHECK_FALSE(queue.push(MAX_SIZE + 1));
+}
+
+TEST_CASE("batches are cut at the free space")
+{
+    cbl::static_mpmc_queue<uint64_t, MAX_SIZE> queue;
+
+    const std::array<uint64_t, MAX_SIZE> batch{ 0, 1, 2, 3, 4, 5, 6, 7 };
+    CHECK(queue.push(batch.data(), 5) == 5);
+    CHECK(queue.push(batch.data() + 5, 5) == 3);
+    CHECK(queue.push(batch.data(), 1) == 0);
+
+    std::array<uint64_t, MAX_SIZE> popped{};
+    CHECK(queue.pop(popped.data(), 3) == 3);
+    CHECK(queue.pop(popped.data() + 3, MAX_SIZE) == 5);
+    CHECK(popped == batch);
+    CHECK(queue.pop(popped.data(), 1) == 0);
+}
+
+TEST_CASE("positions wrap around the storage")
+{
+    queue_t::queue_storage storage;
+    storage.initialize(3);
+    queue_t queue{ storage };
+
+    uint64_t next_push{ 0 };
+    uint64_t next_pop{ 0 };
+
+    // Different batch sizes let the positions cross the end of the storage at every offset.
+    for (unsigned round = 0; round < 20; round++) {
+        const size_t count{ 1 + round % 3 };
+
+        std::array<uint64_t, 3> elems;
+        for (size_t i = 0; i < count; i++) {
+            elems[i] = next_push + i;
+        }
+        REQUIRE(queue.push(elems.data(), count) == count);
+        next_push += count;
+
+        std::array<uint64_t, 3> popped;
+        REQUIRE(queue.pop(popped.data(), 3) == count);
+        for (size_t i = 0; i < count; i++) {
+            CHECK(popped[i] == next_pop++);
+        }
+        CHECK(queue.empty());
+    }
+}
+
+TEST_CASE("existing storage is only used if it has a compatible format")
+{
+    queue_t::queue_storage storage;
+    storage.initialize(4);
+
+    auto queue{ queue_t::create_from_existing_storage(storage) };
+    REQUIRE(queue);
+    CHECK(queue->push(42));
+
+    // Another queue on the same storage sees the element.
+    auto other{ queue_t::create_from_existing_storage(storage) };
+    REQUIRE(other);
+    CHECK(other->pop() == 42u);
+
+    storage.meta_data.version = LFQ_MPMC_API_VERSION + 1;
+    CHECK_FALSE(queue_t::create_from_existing_storage(storage));
+}